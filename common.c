@@ -15,9 +15,154 @@
 
 #include "common.h"
 
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define ESCSIMD                          // use SIMD instructions for escaping
+#include <immintrin.h>
+#endif
+
 #define HEADLVMAX      6                 // maximum level of header
 #define SPACELVMAX     8                 // maximum level of spacer
 #define IMAGELVMAX     6                 // maximum level of image
+#define INLINELVMAX    8                 // maximum level of nesting inline elements
+
+enum {                                   // enumeration for classes of characters for escaping
+  ESCMETA = 1 << 0,                      // meta characters of HTML
+  ESCCTRL = 1 << 1,                      // control characters
+  ESCBRACKET = 1 << 2                    // opening bracket
+};
+
+typedef struct {                         // type of structure for the state of HTML conversion
+  const char *id;                        // ID string of the article
+  const char *buri;                      // base URI
+  int bhl;                               // base header level
+  const char *duri;                      // URI of the data directory
+  int headcnts[HEADLVMAX];               // counters of headers
+  int tblcnt;                            // counter of tables
+  int imgcnt;                            // counter of images
+  char *lstack;                          // stack of list marks
+  int lsasiz;                            // allocated size of the stack of list marks
+  TCXSTR *tmp;                           // working buffer
+  TCXSTR *toc;                           // outline of headers
+  NAMEDIR *names;                        // directory of article names
+} HTMLSTATE;
+
+enum {                                   // enumeration for types of inline elements
+  INLINELINK,                            // link
+  INLINESTRONG,                          // strong
+  INLINECITE,                            // citation
+  INLINEINS,                             // insertion
+  INLINEDEL,                             // deletion
+  INLINECODE,                            // code
+  INLINEVAR,                             // variable
+  INLINERAW,                             // raw string
+  INLINETYPENUM                          // number of types
+};
+
+typedef struct {                         // type of structure for a nesting inline element
+  const char *end;                       // end of the parent region
+  const char *resume;                    // position next to the closing mark
+  const char *tag;                       // closing tag
+  const char *uptr;                      // URI to be added after the element in plain text
+  int usiz;                              // size of the URI
+} INLINEFRAME;
+
+typedef struct {                         // type of structure for positions of closing marks
+  const char *end;                       // end of the whole region
+  const char *from[INLINETYPENUM];       // start of the last search of each mark
+  const char *pos[INLINETYPENUM];        // result of the last search of each mark
+} INLINECACHE;
+
+static const unsigned char esctable[0x100] = {  // classes of characters for escaping
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+  0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+static const char *inlinemarks[INLINETYPENUM] = {
+  "[[", "[*", "[\"", "[+", "[-", "[#", "[$", "[="
+};
+
+static const char *inlinetags[INLINETYPENUM][4] = {
+  { "", "</a>", "", "" },
+  { "<strong>", "</strong>", "__", "__" },
+  { "<cite>", "</cite>", " \"", "\" " },
+  { "<ins>", "</ins>", "++", "++" },
+  { "<del>", "</del>", "--", "--" },
+  { "<code>", "</code>", "##", "##" },
+  { "<var>", "</var>", "$$", "$$" },
+  { "", "", "", "" }
+};
+
+
+/* private function prototypes */
+static void htmlstateinit(HTMLSTATE *state, const char *id, const char *buri, int bhl,
+                          const char *duri);
+static void htmlstatedestroy(HTMLSTATE *state);
+static const char *lineend(const char *rp, const char *ep);
+static const char *skipspc(const char *rp, const char *ep);
+static const char *wikibottom(const char *str, const char *ep);
+static int setvnum(char *buf, uint64_t num);
+static const char *getvnum(const char *rp, const char *ep, uint64_t *np);
+static bool wikinormfast(TCMAP *ncols, TCMAP *cols);
+static bool normattr(TCMAP *ncols, TCMAP *cols, const char *name);
+static bool normdate(TCMAP *ncols, TCMAP *cols, const char *name, int64_t *xdp);
+static bool normspan(const char *ptr, int size);
+static void comcat(TCXSTR *rbuf, int64_t date, const char *owner, int osiz, const char *text,
+                   int tsiz);
+static const char *escscanplain(const char *ptr, const char *ep, int mode);
+#if defined(ESCSIMD)
+static const char *escscansse2(const char *ptr, const char *ep, int mode);
+static const char *escscanavx2(const char *ptr, const char *ep, int mode);
+#endif
+static const char *escscan(const char *ptr, const char *ep, int mode);
+static void htmlescape(TCXSTR *rbuf, const char *ptr, int size);
+static bool spanfwm(const char *ptr, const char *ep, const char *key);
+static void urlencode(TCXSTR *rbuf, const char *ptr, int size);
+static const char *inlinecloser(INLINECACHE *cache, int type, const char *rp, const char *ep);
+static void wikitoinline(TCXSTR *rbuf, const char *ptr, int size, const char *buri,
+                         const char *duri, bool html, NAMEDIR *names);
+static const char *linkname(const char *up, const char *pv, bool sep);
+static void wikitohtmlspan(TCXSTR *rbuf, HTMLSTATE *state, const char *ptr, int size);
+static void wikitohtmlimage(TCXSTR *rbuf, HTMLSTATE *state, const char *line);
+static const char *wikitohtmlblock(TCXSTR *rbuf, HTMLSTATE *state, const char *rp,
+                                   const char *ep);
+static void precloser(TCXSTR *sep, const char *rp, const char *fe);
+static const char *wikichunkend(TCXSTR *sep, const char *rp, const char *ep);
+static void blockcachecut(BLOCKCACHE *cache);
+static void tocappend(TCXSTR *toc, const char *ptr, int size);
+static uint64_t namehash(const void *ptr, int size);
+static void namedirindex(NAMEDIR *dir);
+static bool dbputlinks(const char *path, int64_t id, const char *otext, const char *ntext);
+static int comkey(char *buf, int64_t id, int64_t date);
+static TCMAP *comrecs(int64_t id, TCMAP *cols);
+static bool comrecmatch(TCMAP *recs, const char *kbuf, int ksiz, const char *vbuf, int vsiz);
+static bool dboutcoms(const char *path, int64_t id, TCMAP *cols);
+static int revkey(char *buf, int64_t id, int64_t date);
+static char *revload(TCBDB *rdb, int64_t id, int64_t date, int64_t *datep, int *dnump);
+static bool dbputrev(const char *path, int64_t id, const char *wiki);
+static bool revdiff(TCXSTR *rbuf, const TCLIST *olines, const TCLIST *nlines);
+static char *revpatch(const char *otext, const char *delta);
+static bool revlineeq(const TCLIST *olines, int oidx, const TCLIST *nlines, int nidx);
+static bool arthidden(TCMAP *cols);
+static TCMAP *cntkeys(int64_t id, TCMAP *cols);
+static int64_t dbnamegen(const char *path);
+static bool dbputcounts(const char *path, TCMAP *okeys, TCMAP *nkeys);
+static bool recentput(TCBDB *bdb, int64_t id, int64_t date, const char *owner,
+                      const char *text, int rnum);
+static bool dbputrecent(const char *path, int64_t id, TCMAP *cols);
 
 
 
@@ -29,85 +174,91 @@
 /* Load a Wiki string. */
 void wikiload(TCMAP *cols, const char *str){
   assert(cols && str);
-  TCLIST *lines = tcstrsplit(tcstrskipspc(str), "\n");
-  int lnum = tclistnum(lines);
-  int size = 0;
-  int bottom = 0;
-  for(int i = 0; i < lnum; i++){
-    int lsiz;
-    const char *line = tclistval(lines, i, &lsiz);
-    size += lsiz;
-    if(*line != '#' && *tcstrskipspc(line) != '\0') bottom = i;
-  }
-  TCXSTR *text = tcxstrnew3(size + 1);
-  TCXSTR *comments = tcxstrnew3(size + 1);
+  const char *rp = tcstrskipspc(str);
+  const char *ep = rp + strlen(rp);
+  const char *bottom = wikibottom(rp, ep);
+  TCXSTR *text = tcxstrnew3(ep - rp + 1);
+  TCXSTR *comments = tcxstrnew();
+  TCXSTR *field = tcxstrnew();
+  const char *run = NULL;
   int64_t xdate = INT64_MIN;
   bool body = false;
   char numbuf[NUMBUFSIZ];
-  for(int i = 0; i < lnum; i++){
-    int lsiz;
-    const char *line = tclistval(lines, i, &lsiz);
-    if(lsiz > 0 && line[lsiz-1] == '\r'){
-      lsiz--;
-      ((char *)line)[lsiz] = '\0';
-    }
-    if(*line == '#'){
-      const char *rp = line + 1;
-      if(*rp == ':'){
-        int64_t id = atoi(rp + 1);
+  while(true){
+    const char *le = lineend(rp, ep);
+    const char *fe = le;
+    if(fe > rp && fe[-1] == '\r') fe--;
+    bool copy = false;
+    if(fe > rp && *rp == '#'){
+      int c = (fe - rp > 1) ? rp[1] : '\0';
+      char *fbuf = NULL;
+      if(c != '\0' && strchr(":!cmot%", c)){
+        tcxstrclear(field);
+        tcxstrcat(field, rp + 2, fe - rp - 2);
+        fbuf = (char *)tcxstrptr(field);
+      }
+      if(c == ':'){
+        int64_t id = atoi(fbuf);
         if(id > 0){
           sprintf(numbuf, "%lld", (long long)id);
           tcmapputkeep2(cols, "id", numbuf);
         }
-      } else if(*rp == '!' && !body){
-        rp = tcstrsqzspc((char *)rp + 1);
-        if(*rp != '\0') tcmapputkeep2(cols, "name", rp);
-      } else if(*rp == 'c' && !body){
-        int64_t date = tcstrmktime(rp + 1);
-        if(date != INT64_MIN){
-          sprintf(numbuf, "%lld", (long long)date);
-          tcmapputkeep2(cols, "cdate", numbuf);
-          if(date > xdate) xdate = date;
-        }
-      } else if(*rp == 'm' && !body){
-        int64_t date = tcstrmktime(rp + 1);
+      } else if(c == '!' && !body){
+        fbuf = tcstrsqzspc(fbuf);
+        if(*fbuf != '\0') tcmapputkeep2(cols, "name", fbuf);
+      } else if((c == 'c' || c == 'm') && !body){
+        int64_t date = tcstrmktime(fbuf);
         if(date != INT64_MIN){
           sprintf(numbuf, "%lld", (long long)date);
-          tcmapputkeep2(cols, "mdate", numbuf);
+          tcmapputkeep2(cols, c == 'c' ? "cdate" : "mdate", numbuf);
           if(date > xdate) xdate = date;
         }
-      } else if(*rp == 'o' && !body){
-        rp = tcstrsqzspc((char *)rp + 1);
-        if(*rp != '\0') tcmapputkeep2(cols, "owner", rp);
-      } else if(*rp == 't' && !body){
-        rp = tcstrsqzspc((char *)rp + 1);
-        if(*rp != '\0') tcmapputkeep2(cols, "tags", rp);
-      } else if(*rp == '%' && i > bottom){
-        rp++;
-        char *co = strchr(rp, '|');
+      } else if(c == 'o' && !body){
+        fbuf = tcstrsqzspc(fbuf);
+        if(*fbuf != '\0') tcmapputkeep2(cols, "owner", fbuf);
+      } else if(c == 't' && !body){
+        fbuf = tcstrsqzspc(fbuf);
+        if(*fbuf != '\0') tcmapputkeep2(cols, "tags", fbuf);
+      } else if(c == '%' && rp > bottom){
+        char *co = strchr(fbuf, '|');
         if(co){
           *(co++) = '\0';
           char *ct = strchr(co, '|');
           if(ct){
             *(ct++) = '\0';
-            int64_t date = tcstrmktime(rp);
+            int64_t date = tcstrmktime(fbuf);
             tcstrtrim(co);
             tcstrtrim(ct);
             if(date != INT64_MIN && *co != '\0' && *ct != '\0'){
-              tcxstrprintf(comments, "%lld|%s|%s\n", (long long)date, co, ct);
+              comcat(comments, date, co, strlen(co), ct, strlen(ct));
               if(date > xdate) xdate = date;
             }
           }
         }
-      } else if(*rp == '-' || body){
-        tcxstrcat(text, line, lsiz);
-        tcxstrcat(text, "\n", 1);
+      } else if(c == '-' || body){
+        copy = true;
       }
-    } else if(lsiz > 0 || body){
-      tcxstrcat(text, line, lsiz);
-      tcxstrcat(text, "\n", 1);
+    } else if(fe > rp || body){
+      copy = true;
       body = true;
     }
+    if(copy){
+      if(!run) run = rp;
+      if(fe < le){
+        tcxstrcat(text, run, fe - run);
+        run = le;
+      }
+      if(le >= ep){
+        tcxstrcat(text, run, le - run);
+        tcxstrcat(text, "\n", 1);
+        run = NULL;
+      }
+    } else if(run){
+      tcxstrcat(text, run, rp - run);
+      run = NULL;
+    }
+    if(le >= ep) break;
+    rp = le + 1;
   }
   const char *tbuf = tcxstrptr(text);
   int tsiz = tcxstrsize(text);
@@ -119,9 +270,9 @@ void wikiload(TCMAP *cols, const char *str){
   if(tcxstrsize(comments) > 0)
     tcmapputkeep(cols, "comments", 8, tcxstrptr(comments), tcxstrsize(comments));
   if(xdate != INT64_MIN) tcmapprintf(cols, "xdate", "%lld", (long long)xdate);
+  tcxstrdel(field);
   tcxstrdel(comments);
   tcxstrdel(text);
-  tclistdel(lines);
 }
 
 
@@ -173,39 +324,39 @@ void wikidump(TCXSTR *rbuf, TCMAP *cols){
   int tsiz;
   const char *tbuf = tcmapget(cols, "text", 4, &tsiz);
   if(tbuf && tsiz > 0) tcxstrcat(rbuf, tbuf, tsiz);
-  int csiz;
-  const char *cbuf = tcmapget(cols, "comments", 8, &csiz);
-  if(cbuf && csiz > 0){
-    TCLIST *lines = tcstrsplit(cbuf, "\n");
-    int cnum = tclistnum(lines);
-    if(cnum > 0){
-      tcxstrcat(rbuf, "\n", 1);
-      for(int i = 0; i < cnum; i++){
-        const char *rp = tclistval2(lines, i);
-        char *co = strchr(rp, '|');
-        if(co){
-          *(co++) = '\0';
-          char *ct = strchr(co, '|');
-          if(ct){
-            *(ct++) = '\0';
-            char numbuf[NUMBUFSIZ];
-            tcdatestrwww(tcatoi(rp), INT_MAX, numbuf);
-            tcxstrcat(rbuf, "#% ", 3);
-            tcxstrcat2(rbuf, numbuf);
-            tcxstrcat(rbuf, "|", 1);
-            tcxstrcat2(rbuf, co);
-            tcxstrcat(rbuf, "|", 1);
-            tcxstrcat2(rbuf, ct);
-            tcxstrcat(rbuf, "\n", 1);
-          }
-        }
-      }
-    }
-    tclistdel(lines);
+  COMITER iter;
+  comiterinit(&iter, cols);
+  bool first = true;
+  while(comiternext(&iter)){
+    if(first) tcxstrcat(rbuf, "\n", 1);
+    first = false;
+    char numbuf[NUMBUFSIZ];
+    tcdatestrwww(iter.date, INT_MAX, numbuf);
+    tcxstrcat(rbuf, "#% ", 3);
+    tcxstrcat2(rbuf, numbuf);
+    tcxstrcat(rbuf, "|", 1);
+    tcxstrcat(rbuf, iter.owner, iter.osiz);
+    tcxstrcat(rbuf, "|", 1);
+    tcxstrcat(rbuf, iter.text, iter.tsiz);
+    tcxstrcat(rbuf, "\n", 1);
   }
 }
 
 
+/* Normalize the columns of an article. */
+TCMAP *wikinormalize(TCMAP *cols){
+  assert(cols);
+  TCMAP *ncols = tcmapnew2(TINYBNUM);
+  if(wikinormfast(ncols, cols)) return ncols;
+  tcmapclear(ncols);
+  TCXSTR *wiki = tcxstrnew3(tcmapmsiz(cols) + 1);
+  wikidump(wiki, cols);
+  wikiload(ncols, tcxstrptr(wiki));
+  tcxstrdel(wiki);
+  return ncols;
+}
+
+
 /* Dump the attributes and the body text of an article into a plain text string. */
 void wikidumptext(TCXSTR *rbuf, TCMAP *cols){
   assert(rbuf && cols);
@@ -233,30 +384,15 @@ void wikidumptext(TCXSTR *rbuf, TCMAP *cols){
   }
   const char *text = tcmapget2(cols, "text");
   if(text) wikitotext(rbuf, text);
-  const char *com = tcmapget2(cols, "comments");
-  if(com){
-    TCLIST *lines = tcstrsplit(com, "\n");
-    int cnum = tclistnum(lines);
-    if(cnum > 0){
-      for(int i = 0; i < cnum; i++){
-        const char *rp = tclistval2(lines, i);
-        char *co = strchr(rp, '|');
-        if(co){
-          *(co++) = '\0';
-          char *ct = strchr(co, '|');
-          if(ct){
-            *(ct++) = '\0';
-            char numbuf[NUMBUFSIZ];
-            tcdatestrwww(tcatoi(rp), INT_MAX, numbuf);
-            tcxstrprintf(rbuf, "# ");
-            tcxstrprintf(rbuf, "[%s]: %s: ", numbuf, co);
-            wikitotextinline(rbuf, ct);
-            tcxstrcat(rbuf, "\n", 1);
-          }
-        }
-      }
-    }
-    tclistdel(lines);
+  COMITER iter;
+  comiterinit(&iter, cols);
+  while(comiternext(&iter)){
+    char numbuf[NUMBUFSIZ];
+    tcdatestrwww(iter.date, INT_MAX, numbuf);
+    tcxstrprintf(rbuf, "# ");
+    tcxstrprintf(rbuf, "[%s]: %s: ", numbuf, iter.owner);
+    wikitotextinline(rbuf, iter.text);
+    tcxstrcat(rbuf, "\n", 1);
   }
 }
 
@@ -434,82 +570,92 @@ void wikitotext(TCXSTR *rbuf, const char *str){
 }
 
 
+/* Convert a Wiki string into a tiny summary in plain text. */
+char *wikitotiny(const char *str){
+  assert(str);
+  TCXSTR *xstr = tcxstrnew();
+  wikitotext(xstr, str);
+  char *summary = tcxstrtomalloc(xstr);
+  tcstrutfnorm(summary, TCUNSPACE);
+  tcstrcututf(summary, TINYTEXTLEN);
+  return summary;
+}
+
+
+/* Extract the targets of the links to articles in a Wiki string. */
+TCLIST *wikilinks(const char *str){
+  assert(str);
+  TCLIST *links = tclistnew();
+  TCMAP *uniq = tcmapnew2(TINYBNUM);
+  TCXSTR *sep = tcxstrnew();
+  const char *ep = str + strlen(str);
+  const char *rp = str;
+  bool pre = false;
+  while(rp < ep){
+    const char *le = lineend(rp, ep);
+    const char *fe = le;
+    if(fe > rp && fe[-1] == '\r') fe--;
+    if(pre){
+      if(fe - rp == tcxstrsize(sep) && !memcmp(rp, tcxstrptr(sep), fe - rp)) pre = false;
+    } else if(fe - rp >= 3 && !memcmp(rp, "{{{", 3)){
+      precloser(sep, rp, fe);
+      pre = true;
+    } else if(*rp != '#'){
+      const char *pv = rp;
+      while(pv < le && (pv = memchr(pv, '[', le - pv)) != NULL){
+        if(pv + 1 >= le || pv[1] != '['){
+          pv++;
+          continue;
+        }
+        const char *fp = pv + 2;
+        const char *cp = fp;
+        while(cp + 1 < le && (cp[0] != ']' || cp[1] != ']')){
+          cp++;
+        }
+        if(cp + 1 >= le) break;
+        const char *sep = memchr(fp, '|', cp - fp);
+        const char *up = sep ? sep + 1 : fp;
+        char kbuf[LINEBUFSIZ];
+        int ksiz = -1;
+        const char *np = linkname(up, cp, sep);
+        if(np){
+          // the name is squeezed in the same way as the names of articles
+          if(cp - np < sizeof(kbuf) - 5){
+            memcpy(kbuf, "name:", 5);
+            memcpy(kbuf + 5, np, cp - np);
+            kbuf[5+(cp-np)] = '\0';
+            tcstrsqzspc(kbuf + 5);
+            ksiz = strlen(kbuf);
+            if(ksiz <= 5) ksiz = -1;
+          }
+        } else if(spanfwm(up, cp, "id:")){
+          up = skipspc(up + 3, cp);
+          char numbuf[NUMBUFSIZ];
+          int nsiz = tclmin(cp - up, NUMBUFSIZ - 1);
+          memcpy(numbuf, up, nsiz);
+          numbuf[nsiz] = '\0';
+          int64_t id = tcatoi(numbuf);
+          if(id > 0) ksiz = sprintf(kbuf, "id:%lld", (long long)id);
+        }
+        if(ksiz > 0 && ksiz < sizeof(kbuf) && tcmapputkeep(uniq, kbuf, ksiz, "", 0))
+          tclistpush(links, kbuf, ksiz);
+        pv = cp + 2;
+      }
+    }
+    rp = le + 1;
+  }
+  tcxstrdel(sep);
+  tcmapdel(uniq);
+  return links;
+}
+
+
 /* Add an inline Wiki string into plain text.
    `rbuf' specifies the result buffer.
    `line' specifies the inline Wiki string. */
 void wikitotextinline(TCXSTR *rbuf, const char *line){
   assert(rbuf && line);
-  while(*line != '\0'){
-    const char *pv;
-    if(*line == '['){
-      if(tcstrfwm(line, "[[") && (pv = strstr(line + 2, "]]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        const char *uri = field;
-        char *sep = strchr(field, '|');
-        if(sep){
-          *sep = '\0';
-          uri = sep + 1;
-        }
-        wikitotextinline(rbuf, field);
-        if(strcmp(field, uri)) tcxstrprintf(rbuf, "(%s)", uri);
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[*") && (pv = strstr(line + 2, "*]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "__");
-        wikitotextinline(rbuf, field);
-        tcxstrcat2(rbuf, "__");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[\"") && (pv = strstr(line + 2, "\"]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, " \"");
-        wikitotextinline(rbuf, field);
-        tcxstrcat2(rbuf, "\" ");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[+") && (pv = strstr(line + 2, "+]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "++");
-        wikitotextinline(rbuf, field);
-        tcxstrcat2(rbuf, "++");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[-") && (pv = strstr(line + 2, "-]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "--");
-        wikitotextinline(rbuf, field);
-        tcxstrcat2(rbuf, "--");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[#") && (pv = strstr(line + 2, "#]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "##");
-        wikitotextinline(rbuf, field);
-        tcxstrcat2(rbuf, "##");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[$") && (pv = strstr(line + 2, "$]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "$$");
-        wikitotextinline(rbuf, field);
-        tcxstrcat2(rbuf, "$$");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[=") && (pv = strstr(line + 2, "=]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrprintf(rbuf, "%s", field);
-        tcfree(field);
-        line = pv + 2;
-      } else {
-        tcxstrcat(rbuf, line, 1);
-        line++;
-      }
-    } else {
-      tcxstrcat(rbuf, line, 1);
-      line++;
-    }
-  }
+  wikitoinline(rbuf, line, strlen(line), NULL, NULL, false, NULL);
 }
 
 
@@ -529,7 +675,11 @@ void wikidumphtml(TCXSTR *rbuf, TCMAP *cols, const char *buri, int bhl, const ch
     tcxstrprintf(rbuf, "<div class=\"attributes\">\n");
     char numbuf[NUMBUFSIZ];
     val = tcmapget2(cols, "name");
-    if(val) tcxstrprintf(rbuf, "<h%d class=\"attr ah0\">%@</h%d>\n", bhl + 1, val, bhl + 1);
+    if(val){
+      tcxstrprintf(rbuf, "<h%d class=\"attr ah0\">", bhl + 1);
+      htmlescape(rbuf, val, strlen(val));
+      tcxstrprintf(rbuf, "</h%d>\n", bhl + 1);
+    }
     const char *val = tcmapget2(cols, "id");
     if(val) tcxstrprintf(rbuf, "<div class=\"attr\">ID:"
                          " <span class=\"id\">%lld</span></div>\n", (long long)tcatoi(val));
@@ -546,11 +696,17 @@ void wikidumphtml(TCXSTR *rbuf, TCMAP *cols, const char *buri, int bhl, const ch
                    " <span class=\"mdate\">%@</span></div>\n", numbuf);
     }
     val = tcmapget2(cols, "owner");
-    if(val) tcxstrprintf(rbuf, "<div class=\"attr\">Owner:"
-                         " <span class=\"owner\">%@</span></div>\n", val);
+    if(val){
+      tcxstrcat2(rbuf, "<div class=\"attr\">Owner: <span class=\"owner\">");
+      htmlescape(rbuf, val, strlen(val));
+      tcxstrcat2(rbuf, "</span></div>\n");
+    }
     val = tcmapget2(cols, "tags");
-    if(val) tcxstrprintf(rbuf, "<div class=\"attr\">Tags:"
-                         " <span class=\"tags\">%@</span></div>\n", val);
+    if(val){
+      tcxstrcat2(rbuf, "<div class=\"attr\">Tags: <span class=\"tags\">");
+      htmlescape(rbuf, val, strlen(val));
+      tcxstrcat2(rbuf, "</span></div>\n");
+    }
     tcxstrcat2(rbuf, "</div>\n");
   }
   const char *text = tcmapget2(cols, "text");
@@ -559,40 +715,27 @@ void wikidumphtml(TCXSTR *rbuf, TCMAP *cols, const char *buri, int bhl, const ch
     wikitohtml(rbuf, text, *idbuf != '\0' ? idbuf : NULL, buri, bhl + 1, duri);
     tcxstrcat2(rbuf, "</div>\n");
   }
-  const char *com = tcmapget2(cols, "comments");
-  if(com && *com != '\0'){
-    TCLIST *lines = tcstrsplit(com, "\n");
-    int cnum = tclistnum(lines);
-    if(cnum > 0){
-      tcxstrprintf(rbuf, "<div class=\"comments\">\n");
-      int cnt = 0;
-      for(int i = 0; i < cnum; i++){
-        const char *rp = tclistval2(lines, i);
-        char *co = strchr(rp, '|');
-        if(co){
-          *(co++) = '\0';
-          char *ct = strchr(co, '|');
-          if(ct){
-            *(ct++) = '\0';
-            char numbuf[NUMBUFSIZ];
-            tcdatestrwww(tcatoi(rp), INT_MAX, numbuf);
-            cnt++;
-            tcxstrprintf(rbuf, "<div class=\"comment\"");
-            if(*idbuf != '\0') tcxstrprintf(rbuf, " id=\"%@_c%d\"", idbuf, cnt);
-            tcxstrprintf(rbuf, ">\n");
-            tcxstrprintf(rbuf, "<span class=\"date\">%@</span> :\n", numbuf);
-            tcxstrprintf(rbuf, "<span class=\"owner\">%@</span> :\n", co);
-            tcxstrprintf(rbuf, "<span class=\"text\">");
-            wikitohtmlinline(rbuf, ct, buri, duri);
-            tcxstrprintf(rbuf, "</span>\n");
-            tcxstrprintf(rbuf, "</div>\n");
-          }
-        }
-      }
-      tcxstrcat2(rbuf, "</div>\n");
-    }
-    tclistdel(lines);
+  COMITER iter;
+  comiterinit(&iter, cols);
+  int cnt = 0;
+  while(comiternext(&iter)){
+    if(cnt < 1) tcxstrprintf(rbuf, "<div class=\"comments\">\n");
+    char numbuf[NUMBUFSIZ];
+    tcdatestrwww(iter.date, INT_MAX, numbuf);
+    cnt++;
+    tcxstrprintf(rbuf, "<div class=\"comment\"");
+    if(*idbuf != '\0') tcxstrprintf(rbuf, " id=\"%@_c%d\"", idbuf, cnt);
+    tcxstrprintf(rbuf, ">\n");
+    tcxstrprintf(rbuf, "<span class=\"date\">%@</span> :\n", numbuf);
+    tcxstrcat2(rbuf, "<span class=\"owner\">");
+    htmlescape(rbuf, iter.owner, iter.osiz);
+    tcxstrcat2(rbuf, "</span> :\n");
+    tcxstrprintf(rbuf, "<span class=\"text\">");
+    wikitoinline(rbuf, iter.text, iter.tsiz, buri, duri, true, NULL);
+    tcxstrprintf(rbuf, "</span>\n");
+    tcxstrprintf(rbuf, "</div>\n");
   }
+  if(cnt > 0) tcxstrcat2(rbuf, "</div>\n");
   tcxstrcat2(rbuf, "</div>\n");
 }
 
@@ -601,468 +744,464 @@ void wikidumphtml(TCXSTR *rbuf, TCMAP *cols, const char *buri, int bhl, const ch
 void wikitohtml(TCXSTR *rbuf, const char *str, const char *id, const char *buri, int bhl,
                 const char *duri){
   assert(rbuf && str && buri && bhl >= 0);
-  TCLIST *lines = tcstrsplit(str, "\n");
-  int lnum = tclistnum(lines);
-  int headcnts[HEADLVMAX];
-  memset(headcnts, 0, sizeof(headcnts));
-  int tblcnt = 0;
-  int imgcnt = 0;
-  int ri = 0;
-  while(ri < lnum){
-    int lsiz;
-    const char *line = tclistval(lines, ri, &lsiz);
-    if(lsiz > 0 && line[lsiz-1] == '\r'){
-      lsiz--;
-      ((char *)line)[lsiz] = '\0';
+  wikitohtml2(rbuf, str, id, buri, bhl, duri, NULL, NULL, NULL);
+}
+
+
+/* Convert a Wiki string into an HTML string with a block cache and an outline. */
+void wikitohtml2(TCXSTR *rbuf, const char *str, const char *id, const char *buri, int bhl,
+                 const char *duri, BLOCKCACHE *cache, TCXSTR *toc, NAMEDIR *names){
+  assert(rbuf && str && buri && bhl >= 0);
+  HTMLSTATE state;
+  htmlstateinit(&state, id, buri, bhl, duri);
+  state.toc = toc;
+  state.names = names;
+  const char *rp = str;
+  const char *ep = str + strlen(str);
+  if(!cache){
+    while(rp){
+      rp = wikitohtmlblock(rbuf, &state, rp, ep);
     }
-    if(*line == '#'){
-      ri++;
-    } else if(*line == '*'){
-      int lv = 1;
-      const char *rp = line + 1;
-      while(*rp == '*'){
-        lv++;
-        rp++;
-      }
-      int abslv = lv;
-      lv += bhl;
-      if(lv > HEADLVMAX) lv = HEADLVMAX;
-      rp = tcstrskipspc(rp);
-      if(*rp != '\0'){
-        headcnts[lv-1]++;
-        tcxstrprintf(rbuf, "<h%d", lv);
-        if(id){
-          tcxstrprintf(rbuf, " id=\"%@", id);
-          for(int i = bhl; i < lv; i++){
-            tcxstrprintf(rbuf, "_%d", headcnts[i]);
+    htmlstatedestroy(&state);
+    return;
+  }
+  cache->lastnum = 0;
+  if(!toc) state.toc = tcxstrnew();
+  TCXSTR *sep = tcxstrnew();
+  tcxstrprintf(sep, "toc\t%s\t%s\t%d\t%s", id ? id : "\t", buri, bhl, duri ? duri : "\t");
+  if(names) tcxstrprintf(sep, "\t%llx", (unsigned long long)names->stamp);
+  int stsiz = sizeof(int) * (HEADLVMAX + 2);
+  char kbuf[BLOCKHASHSIZ*2+sizeof(int)*(HEADLVMAX+2)];
+  int ksiz = sizeof(kbuf);
+  char hbuf[LINEBUFSIZ];
+  tcmd5hash(tcxstrptr(sep), tcxstrsize(sep), hbuf);
+  memcpy(kbuf + BLOCKHASHSIZ, hbuf, BLOCKHASHSIZ);
+  int nums[HEADLVMAX+2];
+  while(rp){
+    const char *cend = wikichunkend(sep, rp, ep);
+    tcmd5hash(rp, (cend ? cend : ep) - rp, hbuf);
+    memcpy(kbuf, hbuf, BLOCKHASHSIZ);
+    nums[0] = state.tblcnt;
+    nums[1] = state.imgcnt;
+    memcpy(nums + 2, state.headcnts, sizeof(state.headcnts));
+    memcpy(kbuf + BLOCKHASHSIZ * 2, nums, stsiz);
+    cache->lastnum++;
+    int vsiz;
+    const char *vbuf = tcmapget(cache->blocks, kbuf, ksiz, &vsiz);
+    int hsiz;
+    if(vbuf && vsiz >= stsiz + (int)sizeof(hsiz)){
+      memcpy(nums, vbuf, stsiz);
+      state.tblcnt = nums[0];
+      state.imgcnt = nums[1];
+      memcpy(state.headcnts, nums + 2, sizeof(state.headcnts));
+      memcpy(&hsiz, vbuf + stsiz, sizeof(hsiz));
+      vbuf += stsiz + sizeof(hsiz);
+      vsiz -= stsiz + sizeof(hsiz);
+      tcxstrcat(rbuf, vbuf, hsiz);
+      tcxstrcat(state.toc, vbuf + hsiz, vsiz - hsiz);
+      tcmapmove(cache->blocks, kbuf, ksiz, false);
+      cache->hits++;
+      rp = cend;
+      continue;
+    }
+    int bsiz = tcxstrsize(rbuf);
+    int tsiz = tcxstrsize(state.toc);
+    while(rp && rp != cend){
+      rp = wikitohtmlblock(rbuf, &state, rp, ep);
+    }
+    nums[0] = state.tblcnt;
+    nums[1] = state.imgcnt;
+    memcpy(nums + 2, state.headcnts, sizeof(state.headcnts));
+    hsiz = tcxstrsize(rbuf) - bsiz;
+    tcxstrclear(sep);
+    tcxstrcat(sep, nums, stsiz);
+    tcxstrcat(sep, &hsiz, sizeof(hsiz));
+    tcxstrcat(sep, (const char *)tcxstrptr(rbuf) + bsiz, hsiz);
+    tcxstrcat(sep, (const char *)tcxstrptr(state.toc) + tsiz, tcxstrsize(state.toc) - tsiz);
+    tcmapput(cache->blocks, kbuf, ksiz, tcxstrptr(sep), tcxstrsize(sep));
+    blockcachecut(cache);
+    cache->misses++;
+  }
+  tcxstrdel(sep);
+  if(!toc) tcxstrdel(state.toc);
+  htmlstatedestroy(&state);
+}
+
+
+/* Add an inline Wiki string into HTML. */
+void wikitohtmlinline(TCXSTR *rbuf, const char *line, const char *buri, const char *duri,
+                      NAMEDIR *names){
+  assert(rbuf && line && buri);
+  wikitoinline(rbuf, line, strlen(line), buri, duri, true, names);
+}
+
+
+/* Create a block cache object. */
+BLOCKCACHE *blockcachenew(void){
+  BLOCKCACHE *cache = tcmalloc(sizeof(*cache));
+  cache->blocks = tcmapnew2(BLOCKCACHEMAX * 2 + 1);
+  cache->hits = 0;
+  cache->misses = 0;
+  cache->lastnum = 0;
+  return cache;
+}
+
+
+/* Delete a block cache object. */
+void blockcachedel(BLOCKCACHE *cache){
+  assert(cache);
+  tcmapdel(cache->blocks);
+  tcfree(cache);
+}
+
+
+/* Serialize the blocks used by the last conversion with a block cache. */
+void *blockcachedump(BLOCKCACHE *cache, int *sp){
+  assert(cache && sp);
+  TCMAP *blocks = cache->blocks;
+  int skip = tcmaprnum(blocks) - cache->lastnum;
+  TCMAP *used = tcmapnew2(cache->lastnum + 1);
+  tcmapiterinit(blocks);
+  const char *kbuf;
+  int ksiz;
+  while((kbuf = tcmapiternext(blocks, &ksiz)) != NULL){
+    if(skip-- > 0) continue;
+    int vsiz;
+    const char *vbuf = tcmapiterval(kbuf, &vsiz);
+    tcmapput(used, kbuf, ksiz, vbuf, vsiz);
+  }
+  void *ptr = tcmapdump(used, sp);
+  tcmapdel(used);
+  return ptr;
+}
+
+
+/* Add serialized blocks into a block cache. */
+void blockcacheload(BLOCKCACHE *cache, const void *ptr, int size){
+  assert(cache && ptr && size >= 0);
+  TCMAP *loaded = tcmapload(ptr, size);
+  tcmapiterinit(loaded);
+  const char *kbuf;
+  int ksiz;
+  while((kbuf = tcmapiternext(loaded, &ksiz)) != NULL){
+    int vsiz;
+    const char *vbuf = tcmapiterval(kbuf, &vsiz);
+    tcmapputkeep(cache->blocks, kbuf, ksiz, vbuf, vsiz);
+  }
+  tcmapdel(loaded);
+  blockcachecut(cache);
+}
+
+
+/* Create a directory of article names. */
+NAMEDIR *namedirnew(void){
+  NAMEDIR *dir = tcmalloc(sizeof(*dir));
+  dir->names = tcmapnew();
+  dir->bloom = NULL;
+  dir->bnum = 0;
+  dir->stamp = 0;
+  dir->gen = -1;
+  dir->tdb = NULL;
+  dir->pub = false;
+  namedirindex(dir);
+  return dir;
+}
+
+
+/* Delete a directory of article names. */
+void namedirdel(NAMEDIR *dir){
+  assert(dir);
+  tcfree(dir->bloom);
+  tcmapdel(dir->names);
+  tcfree(dir);
+}
+
+
+/* Load the names of every article into a directory. */
+bool namedirload(NAMEDIR *dir, TCTDB *tdb){
+  assert(dir && tdb);
+  const char *path = tctdbpath(tdb);
+  if(!path) return false;
+  char *cpath = tcsprintf("%s%s", path, CNTSUFFIX);
+  bool loaded = false;
+  bool err = false;
+  TCBDB *bdb = tcbdbnew();
+  if(tcstatfile(cpath, NULL, NULL, NULL) && tcbdbopen(bdb, cpath, BDBOREADER)){
+    int vsiz;
+    const char *vbuf = tcbdbget3(bdb, "g:names", 7, &vsiz);
+    if(vbuf && vsiz == sizeof(int)){
+      int gen;
+      memcpy(&gen, vbuf, sizeof(gen));
+      loaded = true;
+      if(gen != dir->gen || dir->tdb){
+        // the generation is read before the names so that a newer one is not missed
+        tcmapclear(dir->names);
+        BDBCUR *cur = tcbdbcurnew(bdb);
+        if(tcbdbcurjump(cur, "n:", 2)){
+          int ksiz;
+          const char *kbuf;
+          while((kbuf = tcbdbcurkey3(cur, &ksiz)) != NULL && ksiz > 2 && !memcmp(kbuf, "n:", 2)){
+            const char *pv = kbuf + ksiz;
+            while(pv > kbuf + 2 && pv[-1] != '\t'){
+              pv--;
+            }
+            if(pv > kbuf + 3)
+              tcmapputkeep(dir->names, kbuf + 2, pv - kbuf - 3, pv, kbuf + ksiz - pv);
+            if(!tcbdbcurnext(cur)) break;
           }
-          tcxstrprintf(rbuf, "\"");
-        }
-        tcxstrprintf(rbuf, " class=\"ah%d topic\">", abslv);
-        wikitohtmlinline(rbuf, rp, buri, duri);
-        tcxstrprintf(rbuf, "</h%d>\n", lv);
-        for(int i = lv; i < HEADLVMAX; i++){
-          headcnts[lv] = 0;
-        }
-      }
-      ri++;
-    } else if(*line == '-' || *line == '+'){
-      int ei = ri + 1;
-      while(ei < lnum){
-        const char *rp = tclistval2(lines, ei);
-        if(*rp != '-' && *rp != '+') break;
-        ei++;
-      }
-      TCLIST *stack = tclistnew();
-      for(int i = ri; i < ei; i++){
-        const char *rp = tclistval2(lines, i);
-        int sep = *rp;
-        int clv = 1;
-        rp++;
-        while(*rp == sep){
-          clv++;
-          rp++;
-        }
-        rp = tcstrskipspc(rp);
-        if(clv <= tclistnum(stack)) tcxstrcat2(rbuf, "</li>\n");
-        while(clv < tclistnum(stack)){
-          char *tag = tclistpop2(stack);
-          tcxstrprintf(rbuf, "</%s>\n", tag);
-          tcfree(tag);
-          tcxstrcat2(rbuf, "</li>\n");
-        }
-        for(int k = 0; clv > tclistnum(stack); k++){
-          if(k > 0) tcxstrcat2(rbuf, "<li>\n");
-          const char *tag = (sep == '-') ? "ul" : "ol";
-          tclistpush2(stack, tag);
-          tcxstrprintf(rbuf, "<%s>\n", tag);
         }
-        tcxstrcat2(rbuf, "<li>");
-        wikitohtmlinline(rbuf, rp, buri, duri);
+        tcbdbcurdel(cur);
+        namedirindex(dir);
+        dir->gen = gen;
+        dir->tdb = NULL;
       }
-      while(tclistnum(stack) > 0){
-        tcxstrcat2(rbuf, "</li>\n");
-        char *tag = tclistpop2(stack);
-        tcxstrprintf(rbuf, "</%s>\n", tag);
-        tcfree(tag);
+    }
+    if(!tcbdbclose(bdb)) err = true;
+  }
+  tcbdbdel(bdb);
+  tcfree(cpath);
+  // the counter table of an older version does not have the names
+  if(!loaded) namedirsetdb(dir, tdb);
+  return !err;
+}
+
+
+/* Make a directory of article names look up the name index of a database. */
+void namedirsetdb(NAMEDIR *dir, TCTDB *tdb){
+  assert(dir && tdb);
+  tcmapclear(dir->names);
+  dir->gen = -1;
+  dir->tdb = tdb;
+  const char *path = tctdbpath(tdb);
+  dir->stamp = path ? dbnamegen(path) : 0;
+  if(dir->stamp == 0){
+    // the counter table of an older version does not follow the names, so any update of the
+    // database is regarded as a modification of them
+    dir->stamp = ((uint64_t)tctdbmtime(tdb) << 24) ^ tctdbrnum(tdb) ^ (1ULL << 63);
+  }
+}
+
+
+/* Get the ID number of an article in a directory of article names. */
+int64_t namedirget(NAMEDIR *dir, const void *ptr, int size){
+  assert(dir && ptr && size >= 0);
+  int vsiz;
+  const char *vbuf;
+  if(dir->tdb){
+    // results of queries are kept in the map for the other links to the same name
+    vbuf = tcmapget(dir->names, ptr, size, &vsiz);
+    if(vbuf) return tcatoi(vbuf);
+    char *name = tcmemdup(ptr, size);
+    int64_t id = 0;
+    TDBQRY *qry = tctdbqrynew(dir->tdb);
+    tctdbqryaddcond(qry, "name", TDBQCSTREQ, name);
+    tctdbqrysetlimit(qry, 1, 0);
+    TCLIST *res = tctdbqrysearch(qry);
+    if(tclistnum(res) > 0) id = tcatoi(tclistval2(res, 0));
+    tclistdel(res);
+    tctdbqrydel(qry);
+    tcfree(name);
+    char numbuf[NUMBUFSIZ];
+    int nsiz = sprintf(numbuf, "%lld", (long long)id);
+    tcmapput(dir->names, ptr, size, numbuf, nsiz);
+    return id;
+  }
+  uint64_t hash = namehash(ptr, size);
+  uint64_t step = (hash >> 32) | 1;
+  for(int i = 0; i < NAMEBLOOMHASH; i++){
+    uint64_t bit = (hash + step * i) % dir->bnum;
+    if(!(dir->bloom[bit>>6] & (1ULL << (bit & 63)))) return 0;
+  }
+  vbuf = tcmapget(dir->names, ptr, size, &vsiz);
+  return vbuf ? tcatoi(vbuf) : 0;
+}
+
+
+/* Initialize an iterator of the comments of an article. */
+void comiterinit(COMITER *iter, TCMAP *cols){
+  assert(iter && cols);
+  int csiz;
+  const char *cbuf = tcmapget(cols, "comments", 8, &csiz);
+  if(cbuf && csiz > 0 && *cbuf != COMMAGIC){
+    TCXSTR *bin = tcxstrnew3(csiz + 1);
+    const char *rp = cbuf;
+    const char *ep = cbuf + csiz;
+    while(rp < ep){
+      const char *le = lineend(rp, ep);
+      const char *co = memchr(rp, '|', le - rp);
+      const char *ct = co ? memchr(co + 1, '|', le - co - 1) : NULL;
+      if(ct){
+        comcat(bin, tcatoi(rp), co + 1, ct - co - 1, ct + 1, le - ct - 1);
       }
-      tclistdel(stack);
-      ri = ei;
-    } else if(*line == ',' || *line == '|'){
-      int ei = ri + 1;
-      while(ei < lnum){
-        const char *rp = tclistval2(lines, ei);
-        if(*rp != ',' && *rp != '|') break;
-        ei++;
-      }
-      tcxstrprintf(rbuf, "<table summary=\"table:%d\">\n", ++tblcnt);
-      for(int i = ri; i < ei; i++){
-        const char *rp = tclistval2(lines, i);
-        int sep = *rp;
-        rp++;
-        tcxstrcat2(rbuf, "<tr>\n");
-        while(true){
-          tcxstrcat2(rbuf, "<td>");
-          const char *pv = strchr(rp, sep);
-          char *field = pv ? tcmemdup(rp, pv - rp) : tcstrdup(rp);
-          tcstrtrim(field);
-          wikitohtmlinline(rbuf, field, buri, duri);
-          tcfree(field);
-          tcxstrcat2(rbuf, "</td>\n");
-          if(!pv) break;
-          rp = pv + 1;
-        }
-        tcxstrcat2(rbuf, "</tr>\n");
-      }
-      tcxstrcat2(rbuf, "</table>\n");
-      ri = ei;
-    } else if(*line == '>'){
-      int ei = ri + 1;
-      while(ei < lnum){
-        const char *rp = tclistval2(lines, ei);
-        if(*rp != '>') break;
-        ei++;
-      }
-      tcxstrcat2(rbuf, "<blockquote>\n");
-      for(int i = ri; i < ei; i++){
-        const char *rp = tclistval2(lines, i);
-        rp = tcstrskipspc(rp + 1);
-        if(*rp != '\0'){
-          tcxstrcat2(rbuf, "<p>");
-          wikitohtmlinline(rbuf, rp, buri, duri);
-          tcxstrcat2(rbuf, "</p>\n");
-        }
-      }
-      tcxstrcat2(rbuf, "</blockquote>\n");
-      ri = ei;
-    } else if(tcstrfwm(line, "{{{")){
-      TCXSTR *sep = tcxstrnew();
-      line += 3;
-      while(*line != '\0'){
-        switch(*line){
-          case '{': tcxstrprintf(sep, "%c", '}'); break;
-          case '[': tcxstrprintf(sep, "%c", ']'); break;
-          case '<': tcxstrprintf(sep, "%c", '>'); break;
-          case '(': tcxstrprintf(sep, "%c", ')'); break;
-          default: tcxstrcat(sep, line, 1); break;
-        }
-        line++;
-      }
-      tcxstrcat(sep, "}}}", 3);
-      const char *sepstr = tcxstrptr(sep);
-      ri++;
-      int ei = ri;
-      while(ei < lnum){
-        const char *rp = tclistval2(lines, ei);
-        if(!strcmp(rp, sepstr)) break;
-        ei++;
-      }
-      tcxstrcat2(rbuf, "<pre>");
-      for(int i = ri; i < ei; i++){
-        const char *rp = tclistval2(lines, i);
-        tcxstrprintf(rbuf, "%@\n", rp);
-      }
-      tcxstrcat2(rbuf, "</pre>\n");
-      tcxstrdel(sep);
-      ri = ei + 1;
-    } else if(*line == '@'){
-      line++;
-      imgcnt++;
-      bool anc = false;
-      if(*line == '@'){
-        anc = true;
-        line++;
-      }
-      bool obj = false;
-      if(*line == '!'){
-        obj = true;
-        line++;
-      }
-      const char *align = "normal";
-      int lv = 3;
-      if(*line == '<'){
-        align = "left";
-        line++;
-        while(*line == '<' || *line == '>'){
-          lv += (*line == '<') ? 1 : -1;
-          line++;
-        }
-      } else if(*line == '>'){
-        align = "right";
-        line++;
-        while(*line == '<' || *line == '>'){
-          lv += (*line == '>') ? 1 : -1;
-          line++;
-        }
-      } else if(*line == '+'){
-        align = "center";
-        line++;
-        while(*line == '+' || *line == '-'){
-          lv += (*line == '+') ? 1 : -1;
-          line++;
-        }
-      } else if(*line == '|'){
-        align = "table";
-        line++;
-        while(*line == '|'){
-          lv++;
-          line++;
-        }
-      }
-      if(lv < 1) lv = 1;
-      if(lv > IMAGELVMAX) lv = IMAGELVMAX;
-      line = tcstrskipspc(line);
-      if(*line != '\0'){
-        char *uri = tcstrdup(line);
-        int width = 0;
-        bool wratio = false;
-        int height = 0;
-        bool hratio = false;
-        const char *alt = NULL;
-        TCLIST *params = NULL;
-        char *sep = strchr(uri, '|');
-        if(sep){
-          *(sep++) = '\0';
-          width = tcatoi(sep);
-          while(*sep >= '0' && *sep <= '9'){
-            sep++;
-          }
-          if(*sep == '%') wratio = true;
-          sep = strchr(sep, '|');
-          if(sep){
-            sep++;
-            height = tcatoi(sep);
-            while(*sep >= '0' && *sep <= '9'){
-              sep++;
-            }
-            if(*sep == '%') hratio = true;
-            sep = strchr(sep, '|');
-            if(sep){
-              sep++;
-              alt = sep;
-              sep = strchr(sep, '|');
-              if(sep){
-                *(sep++) = '\0';
-                params = tcstrsplit(sep, "|");
-              }
-            }
-          }
-        }
-        const char *name;
-        char *url;
-        if(tcstrfwm(uri, "upfile:")){
-          const char *rp = strstr(uri, ":") + 1;
-          url = tcsprintf("%s/%@", duri ? duri : buri, rp);
-          name = rp;
-        } else {
-          url = tcstrdup(uri);
-          name = strrchr(uri, '/');
-          name = name ? name + 1 : uri;
-        }
-        const char *scale = width > 0 ? "sized" : "ratio";
-        tcxstrprintf(rbuf, "<div class=\"image image_%s image_%s%d image_%s\">",
-                     align, align, lv, scale);
-        if(anc) tcxstrprintf(rbuf, "<a href=\"%@\">", url);
-        if(obj){
-          tcxstrprintf(rbuf, "<object data=\"%@\"", url);
-          const char *type = mimetype(url);
-          if(type) tcxstrprintf(rbuf, " type=\"%@\"", type);
-          if(width > 0) tcxstrprintf(rbuf, " width=\"%d%@\"", width, wratio ? "%" : "");
-          if(height > 0) tcxstrprintf(rbuf, " height=\"%d%@\"", height, hratio ? "%" : "");
-          tcxstrprintf(rbuf, ">");
-          if(params){
-            int pnum = tclistnum(params) - 1;
-            for(int i = 0; i < pnum; i += 2){
-              tcxstrprintf(rbuf, "<param name=\"%@\" value=\"%@\" />",
-                           tclistval2(params, i), tclistval2(params, i + 1));
-            }
-          }
-          if(alt){
-            tcxstrprintf(rbuf, "%@", alt);
-          } else {
-            tcxstrprintf(rbuf, "object:%d:%@", imgcnt, name);
-          }
-          tcxstrprintf(rbuf, "</object>");
-        } else {
-          tcxstrprintf(rbuf, "<img src=\"%@\"", url);
-          if(width > 0) tcxstrprintf(rbuf, " width=\"%d%s\"", width, wratio ? "%" : "");
-          if(height > 0) tcxstrprintf(rbuf, " height=\"%d%s\"", height, hratio ? "%" : "");
-          if(alt){
-            tcxstrprintf(rbuf, " alt=\"%@\"", alt);
-          } else {
-            tcxstrprintf(rbuf, " alt=\"image:%d:%@\"", imgcnt, name);
-          }
-          tcxstrprintf(rbuf, " />");
-        }
-        if(anc) tcxstrprintf(rbuf, "</a>");
-        tcxstrprintf(rbuf, "</div>\n");
-        tcfree(url);
-        if(params) tclistdel(params);
-        tcfree(uri);
-      }
-      ri++;
-    } else if(tcstrfwm(line, "===")){
-      while(*line == '='){
-        line++;
-      }
-      int lv = 0;
-      while(*line == '#'){
-        line++;
-        lv++;
-      }
-      if(lv > SPACELVMAX) lv = SPACELVMAX;
-      tcxstrprintf(rbuf, "<div class=\"rule rule_s%d\">"
-                   "<span>----</span></div>\n", lv);
-      ri++;
-    } else {
-      line = tcstrskipspc(line);
-      if(*line != '\0'){
-        tcxstrcat2(rbuf, "<p>");
-        wikitohtmlinline(rbuf, line, buri, duri);
-        tcxstrcat2(rbuf, "</p>\n");
-        ri++;
-      } else {
-        ri++;
+      rp = le + 1;
+    }
+    tcmapput(cols, "comments", 8, tcxstrptr(bin), tcxstrsize(bin));
+    tcxstrdel(bin);
+    cbuf = tcmapget(cols, "comments", 8, &csiz);
+  }
+  if(cbuf && csiz > 0){
+    iter->rp = cbuf + 1;
+    iter->ep = cbuf + csiz;
+  } else {
+    iter->rp = NULL;
+    iter->ep = NULL;
+  }
+}
+
+
+/* Get the next comment of an iterator of comments. */
+bool comiternext(COMITER *iter){
+  assert(iter);
+  const char *rp = iter->rp;
+  const char *ep = iter->ep;
+  if(!rp || rp >= ep) return false;
+  uint64_t num;
+  if(!(rp = getvnum(rp, ep, &num))) return false;
+  iter->date = (int64_t)(num >> 1) ^ -(int64_t)(num & 1);
+  if(!(rp = getvnum(rp, ep, &num)) || num >= ep - rp) return false;
+  iter->owner = rp;
+  iter->osiz = num;
+  rp += num + 1;
+  if(!(rp = getvnum(rp, ep, &num)) || num >= ep - rp) return false;
+  iter->text = rp;
+  iter->tsiz = num;
+  iter->rp = rp + num + 1;
+  return true;
+}
+
+
+/* Add a comment into the comments of an article. */
+void comadd(TCMAP *cols, int64_t date, const char *owner, const char *text){
+  assert(cols && owner && text);
+  COMITER iter;
+  comiterinit(&iter, cols);
+  TCXSTR *rbuf = tcxstrnew();
+  comcat(rbuf, date, owner, strlen(owner), text, strlen(text));
+  int skip = iter.rp ? 1 : 0;
+  tcmapputcat(cols, "comments", 8, (const char *)tcxstrptr(rbuf) + skip, tcxstrsize(rbuf) - skip);
+  tcxstrdel(rbuf);
+}
+
+
+/* Simplify a date string. */
+char *datestrsimple(char *str){
+  assert(str);
+  char *pv = str;
+  while(*pv > '\0' && *pv <= ' '){
+    pv++;
+  }
+  int len = strlen(pv);
+  if(len <= 16 || pv[4] != '-' || pv[7] != '-' || pv[10] != 'T' || pv[13] != ':') return pv;
+  pv[4] = '/';
+  pv[7] = '/';
+  pv[10] = ' ';
+  pv[16] = '\0';
+  return str;
+}
+
+
+/* Set the template variables of the attributes of an article. */
+void artsetattrs(TCMAP *cols){
+  assert(cols);
+  const char *names[] = { "cdate", "mdate", "xdate" };
+  char numbuf[NUMBUFSIZ];
+  for(int i = 0; i < sizeof(names) / sizeof(*names); i++){
+    const char *rp = tcmapget2(cols, names[i]);
+    if(!rp) continue;
+    tcdatestrwww(tcstrmktime(rp), INT_MAX, numbuf);
+    tcmapput2(cols, names[i], numbuf);
+    char name[NUMBUFSIZ];
+    sprintf(name, "%ssimple", names[i]);
+    tcmapput2(cols, name, datestrsimple(numbuf));
+  }
+  const char *rp = tcmapget2(cols, "tags");
+  if(rp){
+    TCLIST *tags = tcstrsplit(rp, " ,");
+    int idx = 0;
+    while(idx < tclistnum(tags)){
+      rp = tclistval2(tags, idx);
+      if(*rp != '\0'){
+        idx++;
+      } else {
+        tcfree(tclistremove2(tags, idx));
       }
     }
+    tcmapputlist(cols, "taglist", tags);
+    tclistdel(tags);
   }
-  tclistdel(lines);
 }
 
 
-/* Add an inline Wiki string into HTML. */
-void wikitohtmlinline(TCXSTR *rbuf, const char *line, const char *buri, const char *duri){
-  assert(rbuf && line && buri);
-  while(*line != '\0'){
-    const char *pv;
-    if(*line == '['){
-      if(tcstrfwm(line, "[[") && (pv = strstr(line + 2, "]]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        const char *uri = field;
-        char *sep = strchr(field, '|');
-        if(sep){
-          *sep = '\0';
-          uri = sep + 1;
-        }
-        if(tcstrfwm(uri, "http://") || tcstrfwm(uri, "https://") ||
-           tcstrfwm(uri, "ftp://") || tcstrfwm(uri, "mailto:")){
-          tcxstrprintf(rbuf, "<a href=\"%@\">", uri);
-        } else if(tcstrfwm(uri, "id:")){
-          int64_t id = tcatoi(tcstrskipspc(strchr(uri, ':') + 1));
-          tcxstrprintf(rbuf, "<a href=\"%s?id=%lld\">", buri, (long long)(id > 0 ? id : 0));
-        } else if(tcstrfwm(uri, "name:")){
-          uri = tcstrskipspc(strchr(uri, ':') + 1);
-          tcxstrprintf(rbuf, "<a href=\"%s?name=%?\">", buri, uri);
-        } else if(tcstrfwm(uri, "param:")){
-          uri = tcstrskipspc(strchr(uri, ':') + 1);
-          tcxstrprintf(rbuf, "<a href=\"%s%s%@\">", buri, *uri != 0 ? "?" : "", uri);
-        } else if(tcstrfwm(uri, "upfile:")){
-          uri = tcstrskipspc(strchr(uri, ':') + 1);
-          tcxstrprintf(rbuf, "<a href=\"%s/%@\">", duri ? duri : buri, uri);
-        } else if(tcstrfwm(uri, "wpen:")){
-          uri = tcstrskipspc(strchr(uri, ':') + 1);
-          if(*uri == '\0') uri = field;
-          tcxstrprintf(rbuf, "<a href=\"http://en.wikipedia.org/wiki/%?\">", uri);
-        } else if(tcstrfwm(uri, "wpja:")){
-          uri = tcstrskipspc(strchr(uri, ':') + 1);
-          if(*uri == '\0') uri = field;
-          tcxstrprintf(rbuf, "<a href=\"http://ja.wikipedia.org/wiki/%?\">", uri);
-        } else if(sep){
-          uri = tcstrskipspc(uri);
-          tcxstrprintf(rbuf, "<a href=\"%@\">", uri);
-        } else {
-          uri = tcstrskipspc(uri);
-          tcxstrprintf(rbuf, "<a href=\"%s?name=%?\">", buri, uri);
-        }
-        wikitohtmlinline(rbuf, field, buri, duri);
-        tcxstrprintf(rbuf, "</a>");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[*") && (pv = strstr(line + 2, "*]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "<strong>");
-        wikitohtmlinline(rbuf, field, buri, duri);
-        tcxstrcat2(rbuf, "</strong>");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[\"") && (pv = strstr(line + 2, "\"]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "<cite>");
-        wikitohtmlinline(rbuf, field, buri, duri);
-        tcxstrcat2(rbuf, "</cite>");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[+") && (pv = strstr(line + 2, "+]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "<ins>");
-        wikitohtmlinline(rbuf, field, buri, duri);
-        tcxstrcat2(rbuf, "</ins>");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[-") && (pv = strstr(line + 2, "-]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "<del>");
-        wikitohtmlinline(rbuf, field, buri, duri);
-        tcxstrcat2(rbuf, "</del>");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[#") && (pv = strstr(line + 2, "#]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "<code>");
-        wikitohtmlinline(rbuf, field, buri, duri);
-        tcxstrcat2(rbuf, "</code>");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[$") && (pv = strstr(line + 2, "$]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrcat2(rbuf, "<var>");
-        wikitohtmlinline(rbuf, field, buri, duri);
-        tcxstrcat2(rbuf, "</var>");
-        tcfree(field);
-        line = pv + 2;
-      } else if(tcstrfwm(line, "[=") && (pv = strstr(line + 2, "=]")) != NULL){
-        char *field = tcmemdup(line + 2, pv - line - 2);
-        tcxstrprintf(rbuf, "%@", field);
-        tcfree(field);
-        line = pv + 2;
-      } else {
-        switch(*line){
-          case '&': tcxstrcat(rbuf, "&amp;", 5); break;
-          case '<': tcxstrcat(rbuf, "&lt;", 4); break;
-          case '>': tcxstrcat(rbuf, "&gt;", 4); break;
-          case '"': tcxstrcat(rbuf, "&quot;", 6); break;
-          default: tcxstrcat(rbuf, line, 1); break;
-        }
-        line++;
-      }
-    } else {
-      switch(*line){
-        case '&': tcxstrcat(rbuf, "&amp;", 5); break;
-        case '<': tcxstrcat(rbuf, "&lt;", 4); break;
-        case '>': tcxstrcat(rbuf, "&gt;", 4); break;
-        case '"': tcxstrcat(rbuf, "&quot;", 6); break;
-        default: tcxstrcat(rbuf, line, 1); break;
-      }
-      line++;
+/* Set the template variable of the outline of an article. */
+void artsettoc(TCMAP *cols, const char *ptr, int size){
+  assert(cols && ptr && size >= 0);
+  TCLIST *toc = tclistnew();
+  const char *ep = ptr + size;
+  while(ptr < ep){
+    const char *le = memchr(ptr, '\n', ep - ptr);
+    if(!le) le = ep;
+    const char *ip = memchr(ptr, '\t', le - ptr);
+    const char *tp = ip ? memchr(ip + 1, '\t', le - ip - 1) : NULL;
+    if(tp){
+      TCMAP *head = tcmapnew2(TINYBNUM);
+      tcmapput(head, "level", 5, ptr, ip - ptr);
+      tcmapput(head, "id", 2, ip + 1, tp - ip - 1);
+      tcmapput(head, "text", 4, tp + 1, le - tp - 1);
+      tclistpushmap(toc, head);
+      tcmapdel(head);
     }
+    ptr = le + 1;
   }
+  if(tclistnum(toc) > 0) tcmapputlist(cols, "toc", toc);
+  tclistdel(toc);
 }
 
 
-/* Simplify a date string. */
-char *datestrsimple(char *str){
-  assert(str);
-  char *pv = str;
-  while(*pv > '\0' && *pv <= ' '){
-    pv++;
+/* Set the template variables of the comments of an article. */
+int artsetcoms(TCMAP *cols, const char *buri, const char *duri, NAMEDIR *names, TCMAP *htmls){
+  assert(cols && buri);
+  COMITER iter;
+  comiterinit(&iter, cols);
+  TCLIST *comments = NULL;
+  TCXSTR *xstr = NULL;
+  int cnt = 0;
+  while(comiternext(&iter)){
+    if(!comments) comments = tclistnew();
+    TCMAP *comment = tcmapnew2(TINYBNUM);
+    char numbuf[NUMBUFSIZ];
+    tcdatestrwww(iter.date, INT_MAX, numbuf);
+    cnt++;
+    tcmapprintf(comment, "cnt", "%d", cnt);
+    tcmapput2(comment, "date", numbuf);
+    tcmapput2(comment, "datesimple", datestrsimple(numbuf));
+    tcmapput(comment, "owner", 5, iter.owner, iter.osiz);
+    tcmapput(comment, "text", 4, iter.text, iter.tsiz);
+    char ckbuf[NUMBUFSIZ];
+    int cksiz = sprintf(ckbuf, "c%d", cnt);
+    int hsiz;
+    const char *hbuf = htmls ? tcmapget(htmls, ckbuf, cksiz, &hsiz) : NULL;
+    if(!hbuf){
+      if(xstr){
+        tcxstrclear(xstr);
+      } else {
+        xstr = tcxstrnew();
+      }
+      wikitohtmlinline(xstr, iter.text, buri, duri, names);
+      hbuf = tcxstrptr(xstr);
+      hsiz = tcxstrsize(xstr);
+      if(htmls) tcmapput(htmls, ckbuf, cksiz, hbuf, hsiz);
+    }
+    tcmapput(comment, "texthtml", 8, hbuf, hsiz);
+    tclistpushmap(comments, comment);
+    tcmapdel(comment);
   }
-  int len = strlen(pv);
-  if(len <= 16 || pv[4] != '-' || pv[7] != '-' || pv[10] != 'T' || pv[13] != ':') return pv;
-  pv[4] = '/';
-  pv[7] = '/';
-  pv[10] = ' ';
-  pv[16] = '\0';
-  return str;
+  if(comments){
+    tcmapputlist(cols, "comments", comments);
+    tcmapprintf(cols, "comnum", "%d", cnt);
+    tclistdel(comments);
+  }
+  if(xstr) tcxstrdel(xstr);
+  return cnt;
 }
 
 
@@ -1225,6 +1364,13 @@ char *pathencode(const char *str){
 
 /* Store an article into a database. */
 bool dbputart(TCTDB *tdb, int64_t id, TCMAP *cols){
+  assert(tdb && cols);
+  return dbputart2(tdb, id, cols, false);
+}
+
+
+/* Store an article into a database in the bulk mode or not. */
+bool dbputart2(TCTDB *tdb, int64_t id, TCMAP *cols, bool bulk){
   assert(tdb && cols);
   if(id < 1){
     id = tctdbgenuid(tdb);
@@ -1237,14 +1383,33 @@ bool dbputart(TCTDB *tdb, int64_t id, TCMAP *cols){
   }
   bool err = false;
   tcmapout2(cols, "id");
-  int msiz = tcmapmsiz(cols);
-  TCXSTR *wiki = tcxstrnew3(msiz + 1);
-  wikidump(wiki, cols);
-  TCMAP *ncols = tcmapnew2(TINYBNUM);
-  wikiload(ncols, tcxstrptr(wiki));
+  TCMAP *ncols = wikinormalize(cols);
+  const char *text = tcmapget2(ncols, "text");
+  if(text && *text != '\0'){
+    char *summary = wikitotiny(text);
+    tcmapput2(ncols, "texttiny", summary);
+    tcfree(summary);
+  }
   char pkbuf[NUMBUFSIZ];
   int pksiz = sprintf(pkbuf, "%lld", (long long)id);
+  char *otext = NULL;
+  TCMAP *okeys = NULL;
+  if(bulk){
+    if(tctdbput(tdb, pkbuf, pksiz, ncols)){
+      tcmapput2(cols, "id", pkbuf);
+    } else {
+      err = true;
+    }
+    tcmapdel(ncols);
+    return !err;
+  }
   if(tctdbtranbegin(tdb)){
+    TCMAP *ocols = tctdbget(tdb, pkbuf, pksiz);
+    if(ocols){
+      otext = tcstrdup(tcmapget4(ocols, "text", ""));
+      okeys = cntkeys(id, ocols);
+      tcmapdel(ocols);
+    }
     if(tctdbput(tdb, pkbuf, pksiz, ncols)){
       if(tctdbtrancommit(tdb)){
         tcmapput2(cols, "id", pkbuf);
@@ -1258,8 +1423,23 @@ bool dbputart(TCTDB *tdb, int64_t id, TCMAP *cols){
   } else {
     err = true;
   }
+  if(!err){
+    // the revision store is not transactional and only committed versions are recorded
+    TCXSTR *wiki = tcxstrnew3(IOBUFSIZ);
+    wikidump(wiki, ncols);
+    dbputrev(tctdbpath(tdb), id, tcxstrptr(wiki));
+    tcxstrdel(wiki);
+    dboutcache(tctdbpath(tdb), id, false);
+    dbputlinks(tctdbpath(tdb), id, otext, tcmapget4(ncols, "text", ""));
+    dboutcoms(tctdbpath(tdb), id, ncols);
+    TCMAP *nkeys = cntkeys(id, ncols);
+    dbputcounts(tctdbpath(tdb), okeys, nkeys);
+    tcmapdel(nkeys);
+    dbputrecent(tctdbpath(tdb), id, ncols);
+  }
+  if(okeys) tcmapdel(okeys);
+  tcfree(otext);
   tcmapdel(ncols);
-  tcxstrdel(wiki);
   return !err;
 }
 
@@ -1270,7 +1450,15 @@ bool dboutart(TCTDB *tdb, int64_t id){
   bool err = false;
   char pkbuf[NUMBUFSIZ];
   int pksiz = sprintf(pkbuf, "%lld", (long long)id);
+  char *otext = NULL;
+  TCMAP *okeys = NULL;
   if(tctdbtranbegin(tdb)){
+    TCMAP *ocols = tctdbget(tdb, pkbuf, pksiz);
+    if(ocols){
+      otext = tcstrdup(tcmapget4(ocols, "text", ""));
+      okeys = cntkeys(id, ocols);
+      tcmapdel(ocols);
+    }
     if(tctdbout(tdb, pkbuf, pksiz)){
       if(!tctdbtrancommit(tdb)) err = true;
     } else {
@@ -1280,59 +1468,2546 @@ bool dboutart(TCTDB *tdb, int64_t id){
   } else {
     err = true;
   }
+  if(!err){
+    dboutcache(tctdbpath(tdb), id, true);
+    dbputlinks(tctdbpath(tdb), id, otext, NULL);
+    dboutcoms(tctdbpath(tdb), id, NULL);
+    dbputcounts(tctdbpath(tdb), okeys, NULL);
+    dbputrecent(tctdbpath(tdb), id, NULL);
+  }
+  if(okeys) tcmapdel(okeys);
+  tcfree(otext);
   return !err;
 }
 
 
 /* Retrieve an article of the database. */
 TCMAP *dbgetart(TCTDB *tdb, int64_t id){
+  assert(tdb && id > 0);
+  const char *path = tctdbpath(tdb);
+  TCBDB *cdb = path ? dbopencoms(path, false, false) : NULL;
+  TCMAP *cols = dbgetart2(tdb, cdb, id);
+  if(cdb) dbclosecoms(cdb);
+  return cols;
+}
+
+
+/* Retrieve an article of the database with an opened comment store. */
+TCMAP *dbgetart2(TCTDB *tdb, TCBDB *cdb, int64_t id){
   assert(tdb && id > 0);
   char pkbuf[NUMBUFSIZ];
   int pksiz = sprintf(pkbuf, "%lld", (long long)id);
-  return tctdbget(tdb, pkbuf, pksiz);
+  TCMAP *cols = tctdbget(tdb, pkbuf, pksiz);
+  if(cols && cdb) dbgetcoms(cdb, id, cols);
+  return cols;
 }
 
 
-/* Generate the hash value of a user password. */
-void passwordhash(const char *pass, const char *salt, char *buf){
-  assert(pass && salt && buf);
-  TCXSTR *xstr = tcxstrnew();
-  if(*salt != 0) tcxstrprintf(xstr, "%s:", salt);
-  tcxstrcat2(xstr, pass);
-  tcmd5hash(tcxstrptr(xstr), tcxstrsize(xstr), buf);
-  tcxstrdel(xstr);
+/* Open the comment store of the database. */
+TCBDB *dbopencoms(const char *path, bool wmode, bool mutex){
+  assert(path);
+  char *cpath = tcsprintf("%s%s", path, COMSUFFIX);
+  if(!wmode && !tcstatfile(cpath, NULL, NULL, NULL)){
+    tcfree(cpath);
+    return NULL;
+  }
+  TCBDB *cdb = tcbdbnew();
+  if((mutex && !tcbdbsetmutex(cdb)) ||
+     !tcbdbopen(cdb, cpath, wmode ? BDBOWRITER | BDBOCREAT : BDBOREADER)){
+    tcbdbdel(cdb);
+    cdb = NULL;
+  }
+  tcfree(cpath);
+  return cdb;
 }
 
 
-/* Check whether the name of a user is valid. */
-bool checkusername(const char *name){
-  assert(name);
-  if(*name == '\0') return false;
-  while(true){
-    int c = *(name++);
-    if(c == '\0') return true;
-    if(c >= 'a' && c <= 'z') continue;
-    if(c >= 'A' && c <= 'Z') continue;
-    if(c >= '0' && c <= '9') continue;
-    if(strchr("_-.", c)) continue;
-    break;
+/* Close the comment store of the database. */
+bool dbclosecoms(TCBDB *cdb){
+  assert(cdb);
+  bool err = !tcbdbclose(cdb);
+  tcbdbdel(cdb);
+  return !err;
+}
+
+
+/* Append the stored comments of an article to its columns. */
+int dbgetcoms(TCBDB *cdb, int64_t id, TCMAP *cols){
+  assert(cdb && id > 0 && cols);
+  char pbuf[NUMBUFSIZ];
+  int psiz = sprintf(pbuf, "%lld\t", (long long)id);
+  TCXSTR *rbuf = NULL;
+  int cnum = 0;
+  BDBCUR *cur = tcbdbcurnew(cdb);
+  if(tcbdbcurjump(cur, pbuf, psiz)){
+    // records are copied because the leaves may be swapped out by other threads
+    TCXSTR *kxstr = tcxstrnew();
+    TCXSTR *vxstr = tcxstrnew();
+    while(tcbdbcurrec(cur, kxstr, vxstr)){
+      const char *kbuf = tcxstrptr(kxstr);
+      if(tcxstrsize(kxstr) < psiz || memcmp(kbuf, pbuf, psiz)) break;
+      const char *vbuf = tcxstrptr(vxstr);
+      int vsiz = tcxstrsize(vxstr);
+      const char *ep = memchr(vbuf, '\0', vsiz);
+      if(ep){
+        if(!rbuf) rbuf = tcxstrnew();
+        comcat(rbuf, tcatoi(kbuf + psiz), vbuf, ep - vbuf, ep + 1, vsiz - (ep - vbuf) - 1);
+        cnum++;
+      }
+      if(!tcbdbcurnext(cur)) break;
+    }
+    tcxstrdel(vxstr);
+    tcxstrdel(kxstr);
   }
-  return false;
+  tcbdbcurdel(cur);
+  if(rbuf){
+    COMITER iter;
+    comiterinit(&iter, cols);
+    int skip = iter.rp ? 1 : 0;
+    tcmapputcat(cols, "comments", 8, (const char *)tcxstrptr(rbuf) + skip, tcxstrsize(rbuf) - skip);
+    tcxstrdel(rbuf);
+  }
+  return cnum;
 }
 
 
-/* Check whether an article is frozen. */
-bool checkfrozen(TCMAP *cols){
-  assert(cols);
-  const char *tags = tcmapget2(cols, "tags");
-  if(!tags) return false;
-  for(const char *rp = tags; *rp != '\0'; rp++){
-    if((*rp == '*') && (rp == tags || rp[-1] == ' ' || rp[-1] == ',') &&
-       (rp[1] == '\0' || rp[1] == ' ' || rp[1] == ',')) return true;
+/* Get the dates of the revisions of an article. */
+TCLIST *dbgetrevs(const char *path, int64_t id){
+  assert(path && id > 0);
+  TCLIST *dates = tclistnew();
+  char *rpath = tcsprintf("%s%s", path, REVSUFFIX);
+  if(!tcstatfile(rpath, NULL, NULL, NULL)){
+    tcfree(rpath);
+    return dates;
   }
-  return false;
+  TCBDB *rdb = tcbdbnew();
+  if(tcbdbopen(rdb, rpath, BDBOREADER)){
+    char pbuf[NUMBUFSIZ];
+    int psiz = sprintf(pbuf, "%lld\t", (long long)id);
+    TCLIST *keys = tcbdbfwmkeys(rdb, pbuf, psiz, -1);
+    for(int i = 0; i < tclistnum(keys); i++){
+      const char *kbuf = tclistval2(keys, i);
+      tclistprintf(dates, "%lld", (long long)tcatoi(kbuf + psiz));
+    }
+    tclistdel(keys);
+    tcbdbclose(rdb);
+  }
+  tcbdbdel(rdb);
+  tcfree(rpath);
+  return dates;
+}
+
+
+/* Retrieve a revision of an article. */
+char *dbgetrev(const char *path, int64_t id, int64_t date){
+  assert(path && id > 0);
+  char *rpath = tcsprintf("%s%s", path, REVSUFFIX);
+  if(!tcstatfile(rpath, NULL, NULL, NULL)){
+    tcfree(rpath);
+    return NULL;
+  }
+  char *wiki = NULL;
+  TCBDB *rdb = tcbdbnew();
+  if(tcbdbopen(rdb, rpath, BDBOREADER)){
+    wiki = revload(rdb, id, date, NULL, NULL);
+    tcbdbclose(rdb);
+  }
+  tcbdbdel(rdb);
+  tcfree(rpath);
+  return wiki;
+}
+
+
+/* Post a comment to an article of the database. */
+bool dbputcom(TCTDB *tdb, int64_t id, int64_t date, const char *owner, const char *text,
+              int rnum){
+  assert(tdb && id > 0 && owner && text);
+  const char *path = tctdbpath(tdb);
+  char pkbuf[NUMBUFSIZ];
+  int pksiz = sprintf(pkbuf, "%lld", (long long)id);
+  TCMAP *ocols = path ? tctdbget(tdb, pkbuf, pksiz) : NULL;
+  if(!ocols) return false;
+  int64_t xdate = tcatoi(tcmapget4(ocols, "xdate", "0"));
+  bool hidden = arthidden(ocols);
+  tcmapdel(ocols);
+  bool err = false;
+  TCBDB *cdb = dbopencoms(path, true, false);
+  if(cdb){
+    char kbuf[NUMBUFSIZ*2];
+    int ksiz = comkey(kbuf, id, date);
+    int osiz = strlen(owner);
+    int tsiz = strlen(text);
+    char *vbuf = tcmalloc(osiz + tsiz + 2);
+    memcpy(vbuf, owner, osiz + 1);
+    memcpy(vbuf + osiz + 1, text, tsiz + 1);
+    if(!tcbdbputdup(cdb, kbuf, ksiz, vbuf, osiz + tsiz + 1)) err = true;
+    tcfree(vbuf);
+    if(!dbclosecoms(cdb)) err = true;
+  } else {
+    err = true;
+  }
+  if(err){
+    tctdbsetecode(tdb, TCEWRITE, __FILE__, __LINE__, __func__);
+    return false;
+  }
+  if(date > xdate){
+    TCMAP *ncols = tcmapnew2(TINYBNUM);
+    tcmapprintf(ncols, "xdate", "%lld", (long long)date);
+    if(!tctdbputcat(tdb, pkbuf, pksiz, ncols)) err = true;
+    tcmapdel(ncols);
+  }
+  if(!err && rnum > 0 && !hidden){
+    // the recent comment table is derived data and its failure does not fail the post
+    char *rpath = tcsprintf("%s%s", path, RECENTSUFFIX);
+    TCBDB *rdb = tcbdbnew();
+    if(tcbdbopen(rdb, rpath, BDBOWRITER | BDBOCREAT)){
+      recentput(rdb, id, date, owner, text, rnum);
+      tcbdbclose(rdb);
+    }
+    tcbdbdel(rdb);
+    tcfree(rpath);
+  }
+  return !err;
+}
+
+
+/* Retrieve the latest comments from the recent comment table. */
+TCLIST *dbgetrecent(const char *path, int max){
+  assert(path);
+  TCLIST *coms = tclistnew();
+  char *rpath = tcsprintf("%s%s", path, RECENTSUFFIX);
+  if(max < 1 || !tcstatfile(rpath, NULL, NULL, NULL)){
+    tcfree(rpath);
+    return coms;
+  }
+  TCBDB *rdb = tcbdbnew();
+  if(tcbdbopen(rdb, rpath, BDBOREADER)){
+    TCMAP *com = tcmapnew2(TINYBNUM);
+    BDBCUR *cur = tcbdbcurnew(rdb);
+    if(tcbdbcurlast(cur)){
+      int ksiz, vsiz;
+      const char *kbuf, *vbuf;
+      while(tclistnum(coms) < max && (kbuf = tcbdbcurkey3(cur, &ksiz)) != NULL &&
+            (vbuf = tcbdbcurval3(cur, &vsiz)) != NULL){
+        // the value is the ID number, the owner, and the excerpt separated by zero codes
+        const char *owner = memchr(vbuf, '\0', vsiz);
+        const char *text = owner ? memchr(owner + 1, '\0', vbuf + vsiz - owner - 1) : NULL;
+        if(text){
+          tcmapclear(com);
+          tcmapprintf(com, "id", "%lld", (long long)tcatoi(vbuf));
+          tcmapprintf(com, "date", "%lld", (long long)tcatoi(kbuf));
+          tcmapput(com, "owner", 5, owner + 1, text - owner - 1);
+          tcmapput(com, "text", 4, text + 1, vbuf + vsiz - text - 1);
+          tclistpushmap(coms, com);
+        }
+        if(!tcbdbcurprev(cur)) break;
+      }
+    }
+    tcbdbcurdel(cur);
+    tcmapdel(com);
+    tcbdbclose(rdb);
+  }
+  tcbdbdel(rdb);
+  tcfree(rpath);
+  return coms;
+}
+
+
+/* Rebuild the link index of all articles in the database. */
+bool dbbuildlinks(TCTDB *tdb){
+  assert(tdb);
+  const char *path = tctdbpath(tdb);
+  if(!path) return false;
+  char *lpath = tcsprintf("%s%s", path, LINKSUFFIX);
+  if(unlink(lpath) != 0 && tcstatfile(lpath, NULL, NULL, NULL)){
+    tcfree(lpath);
+    return false;
+  }
+  bool err = false;
+  TCBDB *bdb = tcbdbnew();
+  if(tcbdbopen(bdb, lpath, BDBOWRITER | BDBOCREAT | BDBOTRUNC)){
+    TCXSTR *key = tcxstrnew();
+    if(!tctdbiterinit(tdb)) err = true;
+    TCMAP *cols;
+    while(!err && (cols = tctdbiternext3(tdb)) != NULL){
+      int64_t id = tcatoi(tcmapget4(cols, "", ""));
+      const char *text = tcmapget2(cols, "text");
+      if(id > 0 && text){
+        TCLIST *links = wikilinks(text);
+        for(int i = 0; i < tclistnum(links); i++){
+          int lsiz;
+          const char *lbuf = tclistval(links, i, &lsiz);
+          tcxstrclear(key);
+          tcxstrcat(key, lbuf, lsiz);
+          tcxstrprintf(key, "\t%lld", (long long)id);
+          if(!tcbdbputkeep(bdb, tcxstrptr(key), tcxstrsize(key), "", 0) &&
+             tcbdbecode(bdb) != TCEKEEP) err = true;
+        }
+        tclistdel(links);
+      }
+      tcmapdel(cols);
+    }
+    tcxstrdel(key);
+    if(!tcbdbclose(bdb)) err = true;
+  } else {
+    err = true;
+  }
+  tcbdbdel(bdb);
+  tcfree(lpath);
+  return !err;
 }
 
 
+/* Rebuild the counter table of all articles in the database. */
+bool dbbuildcounts(TCTDB *tdb){
+  assert(tdb);
+  const char *path = tctdbpath(tdb);
+  if(!path) return false;
+  char *cpath = tcsprintf("%s%s", path, CNTSUFFIX);
+  bool err = false;
+  TCBDB *bdb = tcbdbnew();
+  if(tcbdbopen(bdb, cpath, BDBOWRITER | BDBOCREAT | BDBOTRUNC)){
+    if(!tctdbiterinit(tdb)) err = true;
+    TCMAP *cols;
+    while(!err && (cols = tctdbiternext3(tdb)) != NULL){
+      TCMAP *keys = cntkeys(tcatoi(tcmapget4(cols, "", "")), cols);
+      tcmapiterinit(keys);
+      int ksiz;
+      const char *kbuf;
+      while((kbuf = tcmapiternext(keys, &ksiz)) != NULL){
+        if(tcbdbaddint(bdb, kbuf, ksiz, 1) == INT_MIN) err = true;
+      }
+      tcmapdel(keys);
+      tcmapdel(cols);
+    }
+    // the generation starts from the time so that it differs from the one before rebuilding
+    if(tcbdbaddint(bdb, "g:names", 7, (int)(time(NULL) % (INT_MAX / 2))) == INT_MIN)
+      err = true;
+    if(!tcbdbclose(bdb)) err = true;
+  } else {
+    err = true;
+  }
+  tcbdbdel(bdb);
+  tcfree(cpath);
+  return !err;
+}
+
+
+/* Rebuild the recent comment table of all articles in the database. */
+bool dbbuildrecent(TCTDB *tdb, int rnum){
+  assert(tdb);
+  const char *path = tctdbpath(tdb);
+  if(!path) return false;
+  char *rpath = tcsprintf("%s%s", path, RECENTSUFFIX);
+  bool err = false;
+  TCBDB *cdb = dbopencoms(path, false, false);
+  TCBDB *rdb = tcbdbnew();
+  if(tcbdbopen(rdb, rpath, BDBOWRITER | BDBOCREAT)){
+    if(rnum < 1) rnum = tclmax(tcbdbrnum(rdb), RECENTNUM);
+    if(!tcbdbvanish(rdb) || !tctdbiterinit(tdb)) err = true;
+    TCMAP *cols;
+    while(!err && (cols = tctdbiternext3(tdb)) != NULL){
+      int64_t id = tcatoi(tcmapget4(cols, "", ""));
+      if(id > 0 && !arthidden(cols)){
+        if(cdb) dbgetcoms(cdb, id, cols);
+        COMITER iter;
+        comiterinit(&iter, cols);
+        while(comiternext(&iter)){
+          if(!recentput(rdb, id, iter.date, iter.owner, iter.text, rnum)) err = true;
+        }
+      }
+      tcmapdel(cols);
+    }
+    if(!tcbdbclose(rdb)) err = true;
+  } else {
+    err = true;
+  }
+  tcbdbdel(rdb);
+  if(cdb && !dbclosecoms(cdb)) err = true;
+  tcfree(rpath);
+  return !err;
+}
+
+
+/* Remove the comments which are stored in the articles from the comment store. */
+bool dbcleancoms(TCTDB *tdb){
+  assert(tdb);
+  const char *path = tctdbpath(tdb);
+  if(!path) return false;
+  char *cpath = tcsprintf("%s%s", path, COMSUFFIX);
+  bool exists = tcstatfile(cpath, NULL, NULL, NULL);
+  tcfree(cpath);
+  if(!exists) return true;
+  TCBDB *cdb = dbopencoms(path, true, false);
+  if(!cdb) return false;
+  bool err = false;
+  // the records are sorted by the ID numbers and each article is read once
+  int64_t cid = 0;
+  TCMAP *recs = NULL;
+  BDBCUR *cur = tcbdbcurnew(cdb);
+  if(tcbdbcurfirst(cur)){
+    int ksiz, vsiz;
+    const char *kbuf, *vbuf;
+    while((kbuf = tcbdbcurkey3(cur, &ksiz)) != NULL && (vbuf = tcbdbcurval3(cur, &vsiz)) != NULL){
+      int64_t id = tcatoi(kbuf);
+      if(id != cid){
+        if(recs) tcmapdel(recs);
+        recs = NULL;
+        cid = id;
+        char pkbuf[NUMBUFSIZ];
+        int pksiz = sprintf(pkbuf, "%lld", (long long)id);
+        TCMAP *cols = id > 0 ? tctdbget(tdb, pkbuf, pksiz) : NULL;
+        if(cols){
+          recs = comrecs(id, cols);
+          tcmapdel(cols);
+        }
+      }
+      if(recs && comrecmatch(recs, kbuf, ksiz, vbuf, vsiz)){
+        if(!tcbdbcurout(cur)){
+          err = true;
+          break;
+        }
+      } else if(!tcbdbcurnext(cur)){
+        break;
+      }
+    }
+  }
+  tcbdbcurdel(cur);
+  if(recs) tcmapdel(recs);
+  if(!dbclosecoms(cdb)) err = true;
+  return !err;
+}
+
+
+/* Retrieve counts of articles from the counter table. */
+TCMAP *dbgetcounts(const char *path, const char *prefix){
+  assert(path && prefix);
+  TCMAP *counts = tcmapnew2(TINYBNUM);
+  char *cpath = tcsprintf("%s%s", path, CNTSUFFIX);
+  if(!tcstatfile(cpath, NULL, NULL, NULL)){
+    tcfree(cpath);
+    return counts;
+  }
+  TCBDB *bdb = tcbdbnew();
+  if(tcbdbopen(bdb, cpath, BDBOREADER)){
+    int psiz = strlen(prefix);
+    BDBCUR *cur = tcbdbcurnew(bdb);
+    if(tcbdbcurjump(cur, prefix, psiz)){
+      int ksiz, vsiz;
+      const char *kbuf, *vbuf;
+      while((kbuf = tcbdbcurkey3(cur, &ksiz)) != NULL && ksiz >= psiz &&
+            !memcmp(kbuf, prefix, psiz) && (vbuf = tcbdbcurval3(cur, &vsiz)) != NULL){
+        if(vsiz == sizeof(int) && ksiz > psiz){
+          int num;
+          memcpy(&num, vbuf, sizeof(num));
+          char numbuf[NUMBUFSIZ];
+          int nsiz = sprintf(numbuf, "%d", num);
+          tcmapput(counts, kbuf + psiz, ksiz - psiz, numbuf, nsiz);
+        }
+        if(!tcbdbcurnext(cur)) break;
+      }
+    }
+    tcbdbcurdel(cur);
+    tcbdbclose(bdb);
+  }
+  tcbdbdel(bdb);
+  tcfree(cpath);
+  return counts;
+}
+
+
+/* Retrieve the ID numbers of articles linking to an article. */
+TCLIST *dbgetbacklinks(const char *path, int64_t id, const char *name){
+  assert(path);
+  TCLIST *srcs = tclistnew();
+  char *lpath = tcsprintf("%s%s", path, LINKSUFFIX);
+  if(!tcstatfile(lpath, NULL, NULL, NULL)){
+    tcfree(lpath);
+    return srcs;
+  }
+  TCBDB *bdb = tcbdbnew();
+  if(tcbdbopen(bdb, lpath, BDBOREADER)){
+    TCTREE *uniq = tctreenew2(tccmpint64, NULL);
+    for(int i = 0; i < 2; i++){
+      char *prefix;
+      if(i == 0){
+        if(id < 1) continue;
+        prefix = tcsprintf("id:%lld\t", (long long)id);
+      } else {
+        if(!name) continue;
+        prefix = tcsprintf("name:%s\t", name);
+      }
+      int psiz = strlen(prefix);
+      TCLIST *keys = tcbdbfwmkeys(bdb, prefix, psiz, -1);
+      for(int j = 0; j < tclistnum(keys); j++){
+        int ksiz;
+        const char *kbuf = tclistval(keys, j, &ksiz);
+        int64_t src = tcatoi(kbuf + psiz);
+        if(src > 0 && src != id) tctreeputkeep(uniq, &src, sizeof(src), "", 0);
+      }
+      tclistdel(keys);
+      tcfree(prefix);
+    }
+    tctreeiterinit(uniq);
+    const char *kbuf;
+    int ksiz;
+    while((kbuf = tctreeiternext(uniq, &ksiz)) != NULL){
+      int64_t src;
+      memcpy(&src, kbuf, sizeof(src));
+      tclistprintf(srcs, "%lld", (long long)src);
+    }
+    tctreedel(uniq);
+    tcbdbclose(bdb);
+  }
+  tcbdbdel(bdb);
+  tcfree(lpath);
+  return srcs;
+}
+
+
+/* Generate the stamp of the stored columns of an article. */
+static void cachestamp(TCMAP *cols, char *buf){
+  const char *mdate = tcmapget2(cols, "mdate");
+  const char *xdate = tcmapget2(cols, "xdate");
+  int tsiz, csiz;
+  if(!tcmapget(cols, "text", 4, &tsiz)) tsiz = -1;
+  if(!tcmapget(cols, "comments", 8, &csiz)) csiz = -1;
+  snprintf(buf, LINEBUFSIZ, "%s:%s:%d:%d", mdate ? mdate : "", xdate ? xdate : "", tsiz, csiz);
+}
+
+
+/* Retrieve the rendered data of an article from the rendering cache. */
+TCMAP *dbgetcache(const char *path, int64_t id, TCMAP *cols, const char *variant){
+  assert(path && id > 0 && cols && variant);
+  char *cpath = tcsprintf("%s%s", path, CACHESUFFIX);
+  TCMAP *data = NULL;
+  TCHDB *hdb = tchdbnew();
+  if(tchdbopen(hdb, cpath, HDBOREADER)){
+    char pkbuf[NUMBUFSIZ];
+    int pksiz = sprintf(pkbuf, "%lld", (long long)id);
+    int rsiz;
+    char *rbuf = tchdbget(hdb, pkbuf, pksiz, &rsiz);
+    if(rbuf){
+      char stamp[LINEBUFSIZ];
+      cachestamp(cols, stamp);
+      int vsiz;
+      char *vbuf = tcmaploadone(rbuf, rsiz, "stamp", 5, &vsiz);
+      if(vbuf && !strcmp(vbuf, stamp)){
+        tcfree(vbuf);
+        vbuf = tcmaploadone(rbuf, rsiz, variant, strlen(variant), &vsiz);
+        if(vbuf) data = tcmapload(vbuf, vsiz);
+      }
+      tcfree(vbuf);
+      tcfree(rbuf);
+    }
+    tchdbclose(hdb);
+  }
+  tchdbdel(hdb);
+  tcfree(cpath);
+  return data;
+}
+
+
+/* Store the rendered data of an article into the rendering cache. */
+bool dbputcache(const char *path, int64_t id, TCMAP *cols, const char *variant, TCMAP *data){
+  assert(path && id > 0 && cols && variant && data);
+  char *cpath = tcsprintf("%s%s", path, CACHESUFFIX);
+  bool err = false;
+  TCHDB *hdb = tchdbnew();
+  tchdbtune(hdb, TUNEBNUM, TUNEAPOW, TUNEFPOW, 0);
+  if(tchdbopen(hdb, cpath, HDBOWRITER | HDBOCREAT)){
+    char pkbuf[NUMBUFSIZ];
+    int pksiz = sprintf(pkbuf, "%lld", (long long)id);
+    char stamp[LINEBUFSIZ];
+    cachestamp(cols, stamp);
+    TCMAP *rec = NULL;
+    int rsiz;
+    char *rbuf = tchdbget(hdb, pkbuf, pksiz, &rsiz);
+    if(rbuf){
+      rec = tcmapload(rbuf, rsiz);
+      const char *ostamp = tcmapget2(rec, "stamp");
+      if(!ostamp || strcmp(ostamp, stamp) || tcmaprnum(rec) > CACHEVARMAX) tcmapclear(rec);
+      tcfree(rbuf);
+    } else {
+      rec = tcmapnew2(TINYBNUM);
+    }
+    tcmapput2(rec, "stamp", stamp);
+    int dsiz;
+    char *dbuf = tcmapdump(data, &dsiz);
+    tcmapput(rec, variant, strlen(variant), dbuf, dsiz);
+    tcfree(dbuf);
+    rbuf = tcmapdump(rec, &rsiz);
+    if(!tchdbput(hdb, pkbuf, pksiz, rbuf, rsiz)) err = true;
+    tcfree(rbuf);
+    tcmapdel(rec);
+    if(!tchdbclose(hdb)) err = true;
+  } else {
+    err = true;
+  }
+  tchdbdel(hdb);
+  tcfree(cpath);
+  return !err;
+}
+
+
+/* Load the rendered blocks of an article from the rendering cache. */
+bool dbgetblocks(const char *path, int64_t id, BLOCKCACHE *cache){
+  assert(path && id > 0 && cache);
+  char *cpath = tcsprintf("%s%s", path, CACHESUFFIX);
+  if(!tcstatfile(cpath, NULL, NULL, NULL)){
+    tcfree(cpath);
+    return true;
+  }
+  bool err = false;
+  TCHDB *hdb = tchdbnew();
+  if(tchdbopen(hdb, cpath, HDBOREADER)){
+    char pkbuf[NUMBUFSIZ];
+    int pksiz = sprintf(pkbuf, "b:%lld", (long long)id);
+    int rsiz;
+    char *rbuf = tchdbget(hdb, pkbuf, pksiz, &rsiz);
+    if(rbuf){
+      blockcacheload(cache, rbuf, rsiz);
+      tcfree(rbuf);
+    }
+    tchdbclose(hdb);
+  } else {
+    err = true;
+  }
+  tchdbdel(hdb);
+  tcfree(cpath);
+  return !err;
+}
+
+
+/* Store the blocks used by the last conversion of an article into the rendering cache. */
+bool dbputblocks(const char *path, int64_t id, BLOCKCACHE *cache){
+  assert(path && id > 0 && cache);
+  char *cpath = tcsprintf("%s%s", path, CACHESUFFIX);
+  bool err = false;
+  TCHDB *hdb = tchdbnew();
+  tchdbtune(hdb, TUNEBNUM, TUNEAPOW, TUNEFPOW, 0);
+  if(tchdbopen(hdb, cpath, HDBOWRITER | HDBOCREAT)){
+    char pkbuf[NUMBUFSIZ];
+    int pksiz = sprintf(pkbuf, "b:%lld", (long long)id);
+    int rsiz;
+    char *rbuf = blockcachedump(cache, &rsiz);
+    if(!tchdbput(hdb, pkbuf, pksiz, rbuf, rsiz)) err = true;
+    tcfree(rbuf);
+    if(!tchdbclose(hdb)) err = true;
+  } else {
+    err = true;
+  }
+  tchdbdel(hdb);
+  tcfree(cpath);
+  return !err;
+}
+
+
+/* Remove the rendered data of an article from the rendering cache. */
+bool dboutcache(const char *path, int64_t id, bool blocks){
+  assert(path && id > 0);
+  char *cpath = tcsprintf("%s%s", path, CACHESUFFIX);
+  if(!tcstatfile(cpath, NULL, NULL, NULL)){
+    tcfree(cpath);
+    return true;
+  }
+  bool err = false;
+  TCHDB *hdb = tchdbnew();
+  if(tchdbopen(hdb, cpath, HDBOWRITER)){
+    char pkbuf[NUMBUFSIZ];
+    int pksiz = sprintf(pkbuf, "%lld", (long long)id);
+    if(!tchdbout(hdb, pkbuf, pksiz) && tchdbecode(hdb) != TCENOREC) err = true;
+    if(blocks){
+      pksiz = sprintf(pkbuf, "b:%lld", (long long)id);
+      if(!tchdbout(hdb, pkbuf, pksiz) && tchdbecode(hdb) != TCENOREC) err = true;
+    }
+    if(!tchdbclose(hdb)) err = true;
+  } else {
+    err = true;
+  }
+  tchdbdel(hdb);
+  tcfree(cpath);
+  return !err;
+}
+
+
+/* Generate the hash value of a user password. */
+void passwordhash(const char *pass, const char *salt, char *buf){
+  assert(pass && salt && buf);
+  TCXSTR *xstr = tcxstrnew();
+  if(*salt != 0) tcxstrprintf(xstr, "%s:", salt);
+  tcxstrcat2(xstr, pass);
+  tcmd5hash(tcxstrptr(xstr), tcxstrsize(xstr), buf);
+  tcxstrdel(xstr);
+}
+
+
+/* Check whether the name of a user is valid. */
+bool checkusername(const char *name){
+  assert(name);
+  if(*name == '\0') return false;
+  while(true){
+    int c = *(name++);
+    if(c == '\0') return true;
+    if(c >= 'a' && c <= 'z') continue;
+    if(c >= 'A' && c <= 'Z') continue;
+    if(c >= '0' && c <= '9') continue;
+    if(strchr("_-.", c)) continue;
+    break;
+  }
+  return false;
+}
+
+
+/* Check whether an article is frozen. */
+bool checkfrozen(TCMAP *cols){
+  assert(cols);
+  const char *tags = tcmapget2(cols, "tags");
+  if(!tags) return false;
+  for(const char *rp = tags; *rp != '\0'; rp++){
+    if((*rp == '*') && (rp == tags || rp[-1] == ' ' || rp[-1] == ',') &&
+       (rp[1] == '\0' || rp[1] == ' ' || rp[1] == ',')) return true;
+  }
+  return false;
+}
+
+
+
+
+/*************************************************************************************************
+ * private features
+ *************************************************************************************************/
+
+
+/* Initialize the state of HTML conversion. */
+static void htmlstateinit(HTMLSTATE *state, const char *id, const char *buri, int bhl,
+                          const char *duri){
+  assert(state && buri && bhl >= 0);
+  state->id = id;
+  state->buri = buri;
+  state->bhl = bhl;
+  state->duri = duri;
+  memset(state->headcnts, 0, sizeof(state->headcnts));
+  state->tblcnt = 0;
+  state->imgcnt = 0;
+  state->tmp = tcxstrnew();
+  state->toc = NULL;
+  state->names = NULL;
+  state->lsasiz = SPACELVMAX;
+  state->lstack = tcmalloc(state->lsasiz);
+}
+
+
+/* Release resources of the state of HTML conversion. */
+static void htmlstatedestroy(HTMLSTATE *state){
+  assert(state);
+  tcfree(state->lstack);
+  tcxstrdel(state->tmp);
+}
+
+
+/* Get the last line of the body text of a Wiki string.
+   `str' specifies the start of the Wiki string.
+   `ep' specifies the end of the Wiki string.
+   The return value is the start of the last line which is neither empty nor a directive, or the
+   start of the string if there is no such line.  Comments are recognized only after it. */
+static const char *wikibottom(const char *str, const char *ep){
+  assert(str && ep);
+  const char *le = ep;
+  while(true){
+    const char *ls = le;
+    while(ls > str && ls[-1] != '\n'){
+      ls--;
+    }
+    if(ls < le && *ls != '#'){
+      const char *pv = ls;
+      while(pv < le && *pv > '\0' && *pv <= ' '){
+        pv++;
+      }
+      if(pv < le) return ls;
+    }
+    if(ls <= str) return str;
+    le = ls - 1;
+  }
+}
+
+
+/* Serialize a number in the variable length format.
+   `buf' specifies the result buffer whose size should be equal to or more than 10 bytes.
+   `num' specifies the number.
+   The return value is the size of the result. */
+static int setvnum(char *buf, uint64_t num){
+  assert(buf);
+  int len = 0;
+  while(num >= 0x80){
+    buf[len++] = (num & 0x7f) | 0x80;
+    num >>= 7;
+  }
+  buf[len++] = num;
+  return len;
+}
+
+
+/* Deserialize a number in the variable length format.
+   `rp' specifies the start of the region.
+   `ep' specifies the end of the region.
+   `np' specifies the pointer to the variable into which the number is assigned.
+   The return value is the position next to the number or `NULL' if the region is broken. */
+static const char *getvnum(const char *rp, const char *ep, uint64_t *np){
+  assert(rp && ep && np);
+  uint64_t num = 0;
+  for(int shift = 0; rp < ep && shift < 64; shift += 7){
+    int c = *(unsigned char *)(rp++);
+    num |= (uint64_t)(c & 0x7f) << shift;
+    if(c < 0x80){
+      *np = num;
+      return rp;
+    }
+  }
+  return NULL;
+}
+
+
+/* Add a comment into a region in the binary format of comments.
+   `rbuf' specifies the result buffer.  If it is empty, the magic byte is added first.
+   `date' specifies the date of the comment.
+   `owner' specifies the owner of the comment.
+   `osiz' specifies the size of the owner.
+   `text' specifies the text of the comment.
+   `tsiz' specifies the size of the text.
+   Each comment is the date, the size of the owner, the owner, a zero code, the size of the text,
+   the text, and a zero code, where the date and the sizes are in the variable length format. */
+static void comcat(TCXSTR *rbuf, int64_t date, const char *owner, int osiz, const char *text,
+                   int tsiz){
+  assert(rbuf && owner && osiz >= 0 && text && tsiz >= 0);
+  char nbuf[NUMBUFSIZ];
+  if(tcxstrsize(rbuf) < 1){
+    *nbuf = COMMAGIC;
+    tcxstrcat(rbuf, nbuf, 1);
+  }
+  int nsiz = setvnum(nbuf, ((uint64_t)date << 1) ^ (uint64_t)(date >> 63));
+  tcxstrcat(rbuf, nbuf, nsiz);
+  nsiz = setvnum(nbuf, osiz);
+  tcxstrcat(rbuf, nbuf, nsiz);
+  tcxstrcat(rbuf, owner, osiz);
+  tcxstrcat(rbuf, "", 1);
+  nsiz = setvnum(nbuf, tsiz);
+  tcxstrcat(rbuf, nbuf, nsiz);
+  tcxstrcat(rbuf, text, tsiz);
+  tcxstrcat(rbuf, "", 1);
+}
+
+
+/* Get the end of the line of a region.
+   `rp' specifies the start of the line.
+   `ep' specifies the end of the region.
+   The return value is the pointer to the line feed or `ep'. */
+static const char *lineend(const char *rp, const char *ep){
+  assert(rp && ep);
+  const char *pv = memchr(rp, '\n', ep - rp);
+  return pv ? pv : ep;
+}
+
+
+/* Skip white spaces at the start of a region.
+   `rp' specifies the start of the region.
+   `ep' specifies the end of the region.
+   The return value is the pointer to the first non-space character or `ep'. */
+static const char *skipspc(const char *rp, const char *ep){
+  assert(rp && ep);
+  while(rp < ep && *rp > '\0' && *rp <= ' '){
+    rp++;
+  }
+  return rp;
+}
+
+
+/* Find the first special character in a region with the portable code.
+   `ptr' specifies the start of the region.
+   `ep' specifies the end of the region.
+   `mode' specifies the set of special characters: `ESCMETA' for the HTML meta characters,
+   `ESCCTRL' for the control characters, `ESCBRACKET' for the opening bracket.
+   The return value is the pointer to the first special character or `ep'. */
+static const char *escscanplain(const char *ptr, const char *ep, int mode){
+  assert(ptr && ep);
+  while(ptr < ep){
+    if(esctable[*(unsigned char *)ptr] & mode) break;
+    ptr++;
+  }
+  return ptr;
+}
+
+
+#if defined(ESCSIMD)
+
+/* Find the first special character in a region with SSE2. */
+static const char *escscansse2(const char *ptr, const char *ep, int mode){
+  assert(ptr && ep);
+  const __m128i amp = _mm_set1_epi8('&');
+  const __m128i lt = _mm_set1_epi8('<');
+  const __m128i gt = _mm_set1_epi8('>');
+  const __m128i quot = _mm_set1_epi8('"');
+  const __m128i brk = _mm_set1_epi8('[');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i neg = _mm_set1_epi8(-1);
+  while(ep - ptr >= 16){
+    __m128i vec = _mm_loadu_si128((const __m128i *)ptr);
+    __m128i hit = _mm_setzero_si128();
+    if(mode & ESCMETA){
+      hit = _mm_or_si128(_mm_cmpeq_epi8(vec, amp), _mm_cmpeq_epi8(vec, lt));
+      hit = _mm_or_si128(hit, _mm_or_si128(_mm_cmpeq_epi8(vec, gt), _mm_cmpeq_epi8(vec, quot)));
+    }
+    if(mode & ESCCTRL)
+      hit = _mm_or_si128(hit, _mm_and_si128(_mm_cmplt_epi8(vec, space),
+                                            _mm_cmpgt_epi8(vec, neg)));
+    if(mode & ESCBRACKET) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(vec, brk));
+    int bits = _mm_movemask_epi8(hit);
+    if(bits) return ptr + __builtin_ctz(bits);
+    ptr += 16;
+  }
+  return escscanplain(ptr, ep, mode);
+}
+
+
+/* Find the first special character in a region with AVX2. */
+__attribute__((target("avx2")))
+static const char *escscanavx2(const char *ptr, const char *ep, int mode){
+  assert(ptr && ep);
+  const __m256i amp = _mm256_set1_epi8('&');
+  const __m256i lt = _mm256_set1_epi8('<');
+  const __m256i gt = _mm256_set1_epi8('>');
+  const __m256i quot = _mm256_set1_epi8('"');
+  const __m256i brk = _mm256_set1_epi8('[');
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i neg = _mm256_set1_epi8(-1);
+  while(ep - ptr >= 32){
+    __m256i vec = _mm256_loadu_si256((const __m256i *)ptr);
+    __m256i hit = _mm256_setzero_si256();
+    if(mode & ESCMETA){
+      hit = _mm256_or_si256(_mm256_cmpeq_epi8(vec, amp), _mm256_cmpeq_epi8(vec, lt));
+      hit = _mm256_or_si256(hit, _mm256_or_si256(_mm256_cmpeq_epi8(vec, gt),
+                                                 _mm256_cmpeq_epi8(vec, quot)));
+    }
+    if(mode & ESCCTRL)
+      hit = _mm256_or_si256(hit, _mm256_and_si256(_mm256_cmpgt_epi8(space, vec),
+                                                  _mm256_cmpgt_epi8(vec, neg)));
+    if(mode & ESCBRACKET) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(vec, brk));
+    unsigned int bits = _mm256_movemask_epi8(hit);
+    if(bits) return ptr + __builtin_ctz(bits);
+    ptr += 32;
+  }
+  return escscansse2(ptr, ep, mode);
+}
+
+#endif
+
+
+/* Find the first special character in a region. */
+static const char *escscan(const char *ptr, const char *ep, int mode){
+  assert(ptr && ep);
+#if defined(ESCSIMD)
+  if(ep - ptr >= 32 && __builtin_cpu_supports("avx2")) return escscanavx2(ptr, ep, mode);
+  return escscansse2(ptr, ep, mode);
+#else
+  return escscanplain(ptr, ep, mode);
+#endif
+}
+
+
+/* Add a region of a string into HTML with escaping meta characters.
+   `rbuf' specifies the result buffer.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region.
+   Control characters except for white spaces are removed as with the `%@' conversion of the
+   function `tcxstrprintf'. */
+static void htmlescape(TCXSTR *rbuf, const char *ptr, int size){
+  assert(rbuf && ptr && size >= 0);
+  const char *ep = ptr + size;
+  const char *sp = ptr;
+  while((ptr = escscan(ptr, ep, ESCMETA | ESCCTRL)) < ep){
+    int c = *ptr;
+    if(c >= 0x09 && c <= 0x0d){
+      ptr++;
+      continue;
+    }
+    if(ptr > sp) tcxstrcat(rbuf, sp, ptr - sp);
+    switch(c){
+      case '&': tcxstrcat(rbuf, "&amp;", 5); break;
+      case '<': tcxstrcat(rbuf, "&lt;", 4); break;
+      case '>': tcxstrcat(rbuf, "&gt;", 4); break;
+      case '"': tcxstrcat(rbuf, "&quot;", 6); break;
+    }
+    sp = ++ptr;
+  }
+  if(ptr > sp) tcxstrcat(rbuf, sp, ptr - sp);
+}
+
+
+/* Check whether a region of a string begins with a key.
+   `ptr' specifies the start of the region.
+   `ep' specifies the end of the region.
+   `key' specifies the key string.
+   The return value is true if the region begins with the key, else, it is false. */
+static bool spanfwm(const char *ptr, const char *ep, const char *key){
+  assert(ptr && ep && key);
+  int ksiz = strlen(key);
+  return ep - ptr >= ksiz && !memcmp(ptr, key, ksiz);
+}
+
+
+/* Add a region of a string into a URI with the URL encoding.
+   `rbuf' specifies the result buffer.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region. */
+static void urlencode(TCXSTR *rbuf, const char *ptr, int size){
+  assert(rbuf && ptr && size >= 0);
+  const char *ep = ptr + size;
+  const char *sp = ptr;
+  while(ptr < ep){
+    int c = *(unsigned char *)ptr;
+    if((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+       c == '_' || c == '-' || c == '.'){
+      ptr++;
+      continue;
+    }
+    if(ptr > sp) tcxstrcat(rbuf, sp, ptr - sp);
+    char obuf[NUMBUFSIZ];
+    sprintf(obuf, "%%%02X", c);
+    tcxstrcat(rbuf, obuf, 3);
+    sp = ++ptr;
+  }
+  if(ptr > sp) tcxstrcat(rbuf, sp, ptr - sp);
+}
+
+
+/* Find the closing mark of an inline element.
+   `cache' specifies the cache of the positions of closing marks.
+   `type' specifies the index of the element.
+   `rp' specifies the start of the search.
+   `ep' specifies the end of the region of the element.
+   The return value is the pointer to the closing mark or `NULL' if it is not found. */
+static const char *inlinecloser(INLINECACHE *cache, int type, const char *rp, const char *ep){
+  assert(cache && type >= 0 && type < INLINETYPENUM && rp && ep);
+  if(!cache->from[type] || cache->from[type] > rp ||
+     (cache->pos[type] && cache->pos[type] < rp)){
+    int mark = inlinemarks[type][1] == '[' ? ']' : inlinemarks[type][1];
+    const char *pos = NULL;
+    const char *pv = (rp < cache->end) ? rp + 1 : cache->end;
+    while(pv < cache->end && (pv = memchr(pv, ']', cache->end - pv)) != NULL){
+      if(pv[-1] == mark){
+        pos = pv - 1;
+        break;
+      }
+      pv++;
+    }
+    cache->from[type] = rp;
+    cache->pos[type] = pos;
+  }
+  const char *pos = cache->pos[type];
+  return (pos && pos + 2 <= ep) ? pos : NULL;
+}
+
+
+/* Add a region of an inline Wiki string into HTML or plain text.
+   `rbuf' specifies the result buffer.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region.
+   `buri' specifies the base URI.
+   `duri' specifies the URI of the data directory.
+   `html' specifies whether to convert into HTML.
+   `names' specifies the directory of article names to check links.  It can be `NULL'. */
+static void wikitoinline(TCXSTR *rbuf, const char *ptr, int size, const char *buri,
+                         const char *duri, bool html, NAMEDIR *names){
+  assert(rbuf && ptr && size >= 0);
+  INLINECACHE cache;
+  memset(&cache, 0, sizeof(cache));
+  cache.end = ptr + size;
+  INLINEFRAME stack[INLINELVMAX];
+  int depth = 0;
+  const char *rp = ptr;
+  const char *ep = ptr + size;
+  while(true){
+    if(rp >= ep){
+      if(depth < 1) break;
+      INLINEFRAME *frame = stack + --depth;
+      if(frame->uptr){
+        tcxstrcat(rbuf, "(", 1);
+        tcxstrcat(rbuf, frame->uptr, frame->usiz);
+        tcxstrcat(rbuf, ")", 1);
+      } else {
+        tcxstrcat2(rbuf, frame->tag);
+      }
+      rp = frame->resume;
+      ep = frame->end;
+      continue;
+    }
+    int type = -1;
+    const char *pv = NULL;
+    if(*rp == '[' && ep - rp >= 2){
+      for(int i = 0; i < INLINETYPENUM; i++){
+        if(rp[1] == inlinemarks[i][1]){
+          type = i;
+          break;
+        }
+      }
+      if(type >= 0 && (depth >= INLINELVMAX ||
+                       !(pv = inlinecloser(&cache, type, rp + 2, ep)))) type = -1;
+    }
+    if(type < 0){
+      const char *sp = rp;
+      if(*rp == '[') rp++;
+      rp = escscan(rp, ep, html ? ESCMETA | ESCBRACKET : ESCBRACKET);
+      if(rp > sp) tcxstrcat(rbuf, sp, rp - sp);
+      if(html && rp < ep){
+        switch(*rp){
+          case '&': tcxstrcat(rbuf, "&amp;", 5); rp++; break;
+          case '<': tcxstrcat(rbuf, "&lt;", 4); rp++; break;
+          case '>': tcxstrcat(rbuf, "&gt;", 4); rp++; break;
+          case '"': tcxstrcat(rbuf, "&quot;", 6); rp++; break;
+        }
+      }
+      continue;
+    }
+    const char *fp = rp + 2;
+    if(type == INLINERAW){
+      if(html){
+        htmlescape(rbuf, fp, pv - fp);
+      } else {
+        tcxstrcat(rbuf, fp, pv - fp);
+      }
+      rp = pv + 2;
+      continue;
+    }
+    INLINEFRAME *frame = stack + depth++;
+    frame->end = ep;
+    frame->resume = pv + 2;
+    frame->tag = inlinetags[type][html ? 1 : 3];
+    frame->uptr = NULL;
+    frame->usiz = 0;
+    ep = pv;
+    rp = fp;
+    if(type == INLINELINK){
+      const char *sep = memchr(fp, '|', pv - fp);
+      const char *up = fp;
+      if(sep){
+        ep = sep;
+        up = sep + 1;
+      }
+      if(html){
+        const char *np = linkname(up, pv, sep);
+        int64_t nid = (np && names) ? namedirget(names, np, pv - np) : 0;
+        if(np && names && nid < 1){
+          tcxstrprintf(rbuf, "<a href=\"%s?act=edit&amp;name=", buri);
+          urlencode(rbuf, np, pv - np);
+          tcxstrcat2(rbuf, "\" class=\"missing\">");
+          continue;
+        }
+        tcxstrcat2(rbuf, "<a href=\"");
+        if(nid > 0 && names->pub){
+          tcxstrprintf(rbuf, "%lld.html", (long long)nid);
+        } else if(spanfwm(up, pv, "http://") || spanfwm(up, pv, "https://") ||
+           spanfwm(up, pv, "ftp://") || spanfwm(up, pv, "mailto:")){
+          htmlescape(rbuf, up, pv - up);
+        } else if(spanfwm(up, pv, "id:")){
+          up = skipspc(up + 3, pv);
+          char numbuf[NUMBUFSIZ];
+          int nsiz = tclmin(pv - up, NUMBUFSIZ - 1);
+          memcpy(numbuf, up, nsiz);
+          numbuf[nsiz] = '\0';
+          int64_t id = tcatoi(numbuf);
+          if(names && names->pub && id > 0){
+            tcxstrprintf(rbuf, "%lld.html", (long long)id);
+          } else {
+            tcxstrprintf(rbuf, "%s?id=%lld", buri, (long long)(id > 0 ? id : 0));
+          }
+        } else if(spanfwm(up, pv, "name:")){
+          up = skipspc(up + 5, pv);
+          tcxstrprintf(rbuf, "%s?name=", buri);
+          urlencode(rbuf, up, pv - up);
+        } else if(spanfwm(up, pv, "param:")){
+          up = skipspc(up + 6, pv);
+          tcxstrprintf(rbuf, "%s%s", buri, up < pv ? "?" : "");
+          htmlescape(rbuf, up, pv - up);
+        } else if(spanfwm(up, pv, "upfile:")){
+          up = skipspc(up + 7, pv);
+          tcxstrprintf(rbuf, "%s/", duri ? duri : buri);
+          htmlescape(rbuf, up, pv - up);
+        } else if(spanfwm(up, pv, "wpen:") || spanfwm(up, pv, "wpja:")){
+          tcxstrprintf(rbuf, "http://%c%c.wikipedia.org/wiki/", up[2], up[3]);
+          up = skipspc(up + 5, pv);
+          if(up < pv){
+            urlencode(rbuf, up, pv - up);
+          } else {
+            urlencode(rbuf, fp, ep - fp);
+          }
+        } else if(sep){
+          up = skipspc(up, pv);
+          htmlescape(rbuf, up, pv - up);
+        } else {
+          up = skipspc(up, pv);
+          tcxstrprintf(rbuf, "%s?name=", buri);
+          urlencode(rbuf, up, pv - up);
+        }
+        tcxstrcat2(rbuf, "\">");
+      } else if(sep && (pv - up != ep - fp || memcmp(up, fp, ep - fp))){
+        frame->uptr = up;
+        frame->usiz = pv - up;
+      }
+    } else {
+      tcxstrcat2(rbuf, inlinetags[type][html ? 0 : 2]);
+    }
+  }
+}
+
+
+/* Add a region of an inline Wiki string into HTML.
+   `rbuf' specifies the result buffer.
+   `state' specifies the state of conversion.
+   `ptr' specifies the pointer to the region.
+   `size' specifies the size of the region. */
+static void wikitohtmlspan(TCXSTR *rbuf, HTMLSTATE *state, const char *ptr, int size){
+  assert(rbuf && state && ptr && size >= 0);
+  wikitoinline(rbuf, ptr, size, state->buri, state->duri, true, state->names);
+}
+
+
+/* Add an image or an object into HTML.
+   `rbuf' specifies the result buffer.
+   `state' specifies the state of conversion.
+   `line' specifies the line of the image without the leading mark. */
+static void wikitohtmlimage(TCXSTR *rbuf, HTMLSTATE *state, const char *line){
+  assert(rbuf && state && line);
+  state->imgcnt++;
+  bool anc = false;
+  if(*line == '@'){
+    anc = true;
+    line++;
+  }
+  bool obj = false;
+  if(*line == '!'){
+    obj = true;
+    line++;
+  }
+  const char *align = "normal";
+  int lv = 3;
+  if(*line == '<'){
+    align = "left";
+    line++;
+    while(*line == '<' || *line == '>'){
+      lv += (*line == '<') ? 1 : -1;
+      line++;
+    }
+  } else if(*line == '>'){
+    align = "right";
+    line++;
+    while(*line == '<' || *line == '>'){
+      lv += (*line == '>') ? 1 : -1;
+      line++;
+    }
+  } else if(*line == '+'){
+    align = "center";
+    line++;
+    while(*line == '+' || *line == '-'){
+      lv += (*line == '+') ? 1 : -1;
+      line++;
+    }
+  } else if(*line == '|'){
+    align = "table";
+    line++;
+    while(*line == '|'){
+      lv++;
+      line++;
+    }
+  }
+  if(lv < 1) lv = 1;
+  if(lv > IMAGELVMAX) lv = IMAGELVMAX;
+  line = tcstrskipspc(line);
+  if(*line != '\0'){
+    char *uri = tcstrdup(line);
+    int width = 0;
+    bool wratio = false;
+    int height = 0;
+    bool hratio = false;
+    const char *alt = NULL;
+    TCLIST *params = NULL;
+    char *sep = strchr(uri, '|');
+    if(sep){
+      *(sep++) = '\0';
+      width = tcatoi(sep);
+      while(*sep >= '0' && *sep <= '9'){
+        sep++;
+      }
+      if(*sep == '%') wratio = true;
+      sep = strchr(sep, '|');
+      if(sep){
+        sep++;
+        height = tcatoi(sep);
+        while(*sep >= '0' && *sep <= '9'){
+          sep++;
+        }
+        if(*sep == '%') hratio = true;
+        sep = strchr(sep, '|');
+        if(sep){
+          sep++;
+          alt = sep;
+          sep = strchr(sep, '|');
+          if(sep){
+            *(sep++) = '\0';
+            params = tcstrsplit(sep, "|");
+          }
+        }
+      }
+    }
+    const char *name;
+    char *url;
+    if(tcstrfwm(uri, "upfile:")){
+      const char *rp = strstr(uri, ":") + 1;
+      url = tcsprintf("%s/%@", state->duri ? state->duri : state->buri, rp);
+      name = rp;
+    } else {
+      url = tcstrdup(uri);
+      name = strrchr(uri, '/');
+      name = name ? name + 1 : uri;
+    }
+    const char *scale = width > 0 ? "sized" : "ratio";
+    tcxstrprintf(rbuf, "<div class=\"image image_%s image_%s%d image_%s\">",
+                 align, align, lv, scale);
+    int usiz = strlen(url);
+    if(anc){
+      tcxstrcat2(rbuf, "<a href=\"");
+      htmlescape(rbuf, url, usiz);
+      tcxstrcat2(rbuf, "\">");
+    }
+    if(obj){
+      tcxstrcat2(rbuf, "<object data=\"");
+      htmlescape(rbuf, url, usiz);
+      tcxstrcat2(rbuf, "\"");
+      const char *type = mimetype(url);
+      if(type) tcxstrprintf(rbuf, " type=\"%@\"", type);
+      if(width > 0) tcxstrprintf(rbuf, " width=\"%d%@\"", width, wratio ? "%" : "");
+      if(height > 0) tcxstrprintf(rbuf, " height=\"%d%@\"", height, hratio ? "%" : "");
+      tcxstrprintf(rbuf, ">");
+      if(params){
+        int pnum = tclistnum(params) - 1;
+        for(int i = 0; i < pnum; i += 2){
+          tcxstrprintf(rbuf, "<param name=\"%@\" value=\"%@\" />",
+                       tclistval2(params, i), tclistval2(params, i + 1));
+        }
+      }
+      if(alt){
+        htmlescape(rbuf, alt, strlen(alt));
+      } else {
+        tcxstrprintf(rbuf, "object:%d:%@", state->imgcnt, name);
+      }
+      tcxstrprintf(rbuf, "</object>");
+    } else {
+      tcxstrcat2(rbuf, "<img src=\"");
+      htmlescape(rbuf, url, usiz);
+      tcxstrcat2(rbuf, "\"");
+      if(width > 0) tcxstrprintf(rbuf, " width=\"%d%s\"", width, wratio ? "%" : "");
+      if(height > 0) tcxstrprintf(rbuf, " height=\"%d%s\"", height, hratio ? "%" : "");
+      if(alt){
+        tcxstrcat2(rbuf, " alt=\"");
+        htmlescape(rbuf, alt, strlen(alt));
+        tcxstrcat2(rbuf, "\"");
+      } else {
+        tcxstrprintf(rbuf, " alt=\"image:%d:%@\"", state->imgcnt, name);
+      }
+      tcxstrprintf(rbuf, " />");
+    }
+    if(anc) tcxstrprintf(rbuf, "</a>");
+    tcxstrprintf(rbuf, "</div>\n");
+    tcfree(url);
+    if(params) tclistdel(params);
+    tcfree(uri);
+  }
+}
+
+
+/* Convert a block of a Wiki string into HTML.
+   `rbuf' specifies the result buffer.
+   `state' specifies the state of conversion.
+   `rp' specifies the start of the first line of the block.
+   `ep' specifies the end of the Wiki string.
+   The return value is the start of the line next to the block or `NULL' if the whole string
+   has been converted. */
+static const char *wikitohtmlblock(TCXSTR *rbuf, HTMLSTATE *state, const char *rp,
+                                   const char *ep){
+  assert(rbuf && state && rp && ep);
+  const char *le = lineend(rp, ep);
+  const char *next = (le < ep) ? le + 1 : NULL;
+  const char *fe = le;
+  if(fe > rp && fe[-1] == '\r') fe--;
+  int c = (fe > rp) ? *rp : '\0';
+  int bhl = state->bhl;
+  if(c == '#'){
+    return next;
+  } else if(c == '*'){
+    int lv = 1;
+    const char *pv = rp + 1;
+    while(pv < fe && *pv == '*'){
+      lv++;
+      pv++;
+    }
+    int abslv = lv;
+    lv += bhl;
+    if(lv > HEADLVMAX) lv = HEADLVMAX;
+    pv = skipspc(pv, fe);
+    if(pv < fe){
+      int *headcnts = state->headcnts;
+      headcnts[lv-1]++;
+      tcxstrprintf(rbuf, "<h%d", lv);
+      int ioff = tcxstrsize(rbuf);
+      int isiz = 0;
+      if(state->id){
+        tcxstrcat2(rbuf, " id=\"");
+        ioff = tcxstrsize(rbuf);
+        htmlescape(rbuf, state->id, strlen(state->id));
+        for(int i = bhl; i < lv; i++){
+          tcxstrprintf(rbuf, "_%d", headcnts[i]);
+        }
+        isiz = tcxstrsize(rbuf) - ioff;
+        tcxstrprintf(rbuf, "\"");
+      }
+      tcxstrprintf(rbuf, " class=\"ah%d topic\">", abslv);
+      int toff = tcxstrsize(rbuf);
+      wikitohtmlspan(rbuf, state, pv, fe - pv);
+      if(state->toc){
+        tcxstrprintf(state->toc, "%d\t", abslv);
+        tcxstrcat(state->toc, (const char *)tcxstrptr(rbuf) + ioff, isiz);
+        tcxstrcat2(state->toc, "\t");
+        tocappend(state->toc, (const char *)tcxstrptr(rbuf) + toff, tcxstrsize(rbuf) - toff);
+        tcxstrcat2(state->toc, "\n");
+      }
+      tcxstrprintf(rbuf, "</h%d>\n", lv);
+      if(lv < HEADLVMAX) headcnts[lv] = 0;
+    }
+    return next;
+  } else if(c == '-' || c == '+'){
+    int depth = 0;
+    while(true){
+      int sep = *rp;
+      int clv = 1;
+      const char *pv = rp + 1;
+      while(pv < fe && *pv == sep){
+        clv++;
+        pv++;
+      }
+      pv = skipspc(pv, fe);
+      if(clv <= depth) tcxstrcat2(rbuf, "</li>\n");
+      while(clv < depth){
+        depth--;
+        tcxstrprintf(rbuf, "</%s>\n", state->lstack[depth] == '-' ? "ul" : "ol");
+        tcxstrcat2(rbuf, "</li>\n");
+      }
+      if(clv > state->lsasiz){
+        state->lsasiz = clv * 2;
+        state->lstack = tcrealloc(state->lstack, state->lsasiz);
+      }
+      for(int k = 0; clv > depth; k++){
+        if(k > 0) tcxstrcat2(rbuf, "<li>\n");
+        state->lstack[depth++] = sep;
+        tcxstrprintf(rbuf, "<%s>\n", sep == '-' ? "ul" : "ol");
+      }
+      tcxstrcat2(rbuf, "<li>");
+      wikitohtmlspan(rbuf, state, pv, fe - pv);
+      if(!next || next >= ep || (*next != '-' && *next != '+')) break;
+      rp = next;
+      fe = le = lineend(rp, ep);
+      next = (le < ep) ? le + 1 : NULL;
+    }
+    while(depth > 0){
+      tcxstrcat2(rbuf, "</li>\n");
+      depth--;
+      tcxstrprintf(rbuf, "</%s>\n", state->lstack[depth] == '-' ? "ul" : "ol");
+    }
+    return next;
+  } else if(c == ',' || c == '|'){
+    tcxstrprintf(rbuf, "<table summary=\"table:%d\">\n", ++state->tblcnt);
+    while(true){
+      int sep = *rp;
+      const char *pv = rp + 1;
+      tcxstrcat2(rbuf, "<tr>\n");
+      while(true){
+        tcxstrcat2(rbuf, "<td>");
+        const char *cp = memchr(pv, sep, fe - pv);
+        const char *ce = cp ? cp : fe;
+        const char *cs = skipspc(pv, ce);
+        while(ce > cs && ce[-1] > '\0' && ce[-1] <= ' '){
+          ce--;
+        }
+        wikitohtmlspan(rbuf, state, cs, ce - cs);
+        tcxstrcat2(rbuf, "</td>\n");
+        if(!cp) break;
+        pv = cp + 1;
+      }
+      tcxstrcat2(rbuf, "</tr>\n");
+      if(!next || next >= ep || (*next != ',' && *next != '|')) break;
+      rp = next;
+      fe = le = lineend(rp, ep);
+      next = (le < ep) ? le + 1 : NULL;
+    }
+    tcxstrcat2(rbuf, "</table>\n");
+    return next;
+  } else if(c == '>'){
+    tcxstrcat2(rbuf, "<blockquote>\n");
+    while(true){
+      const char *pv = skipspc(rp + 1, fe);
+      if(pv < fe){
+        tcxstrcat2(rbuf, "<p>");
+        wikitohtmlspan(rbuf, state, pv, fe - pv);
+        tcxstrcat2(rbuf, "</p>\n");
+      }
+      if(!next || next >= ep || *next != '>') break;
+      rp = next;
+      fe = le = lineend(rp, ep);
+      next = (le < ep) ? le + 1 : NULL;
+    }
+    tcxstrcat2(rbuf, "</blockquote>\n");
+    return next;
+  } else if(fe - rp >= 3 && !memcmp(rp, "{{{", 3)){
+    TCXSTR *sep = state->tmp;
+    precloser(sep, rp, fe);
+    const char *sepstr = tcxstrptr(sep);
+    int sepsiz = tcxstrsize(sep);
+    tcxstrcat2(rbuf, "<pre>");
+    rp = next;
+    while(rp){
+      le = lineend(rp, ep);
+      next = (le < ep) ? le + 1 : NULL;
+      if(le - rp == sepsiz && !memcmp(rp, sepstr, sepsiz)) break;
+      htmlescape(rbuf, rp, le - rp);
+      tcxstrcat(rbuf, "\n", 1);
+      rp = next;
+    }
+    tcxstrcat2(rbuf, "</pre>\n");
+    return rp ? next : NULL;
+  } else if(c == '@'){
+    TCXSTR *tmp = state->tmp;
+    tcxstrclear(tmp);
+    tcxstrcat(tmp, rp + 1, fe - rp - 1);
+    wikitohtmlimage(rbuf, state, tcxstrptr(tmp));
+    return next;
+  } else if(fe - rp >= 3 && !memcmp(rp, "===", 3)){
+    const char *pv = rp;
+    while(pv < fe && *pv == '='){
+      pv++;
+    }
+    int lv = 0;
+    while(pv < fe && *pv == '#'){
+      pv++;
+      lv++;
+    }
+    if(lv > SPACELVMAX) lv = SPACELVMAX;
+    tcxstrprintf(rbuf, "<div class=\"rule rule_s%d\">"
+                 "<span>----</span></div>\n", lv);
+    return next;
+  }
+  const char *pv = skipspc(rp, fe);
+  if(pv < fe){
+    tcxstrcat2(rbuf, "<p>");
+    wikitohtmlspan(rbuf, state, pv, fe - pv);
+    tcxstrcat2(rbuf, "</p>\n");
+  }
+  return next;
+}
+
+
+
+/* Generate the closing line of a preformatted block.
+   `sep' specifies the buffer into which the closing line is written.
+   `rp' specifies the start of the opening line.
+   `fe' specifies the end of the opening line. */
+static void precloser(TCXSTR *sep, const char *rp, const char *fe){
+  assert(sep && rp && fe);
+  tcxstrclear(sep);
+  for(const char *pv = rp + 3; pv < fe; pv++){
+    switch(*pv){
+      case '{': tcxstrcat(sep, "}", 1); break;
+      case '[': tcxstrcat(sep, "]", 1); break;
+      case '<': tcxstrcat(sep, ">", 1); break;
+      case '(': tcxstrcat(sep, ")", 1); break;
+      default: tcxstrcat(sep, pv, 1); break;
+    }
+  }
+  tcxstrcat(sep, "}}}", 3);
+}
+
+
+/* Get the end of a section of Wiki text.
+   `sep' specifies a working buffer.
+   `rp' specifies the start of the section.
+   `ep' specifies the end of the whole text.
+   The return value is the start of the next section or `NULL' if the section lasts to the end.
+   A section ends after an empty line outside preformatted blocks, which is always a boundary of
+   blocks. */
+static const char *wikichunkend(TCXSTR *sep, const char *rp, const char *ep){
+  assert(sep && rp && ep);
+  while(rp < ep){
+    const char *le = lineend(rp, ep);
+    const char *fe = le;
+    if(fe > rp && fe[-1] == '\r') fe--;
+    if(le >= ep) return NULL;
+    if(fe == rp) return le + 1;
+    if(fe - rp >= 3 && !memcmp(rp, "{{{", 3)){
+      precloser(sep, rp, fe);
+      const char *sepstr = tcxstrptr(sep);
+      int sepsiz = tcxstrsize(sep);
+      rp = le + 1;
+      while(rp < ep){
+        le = lineend(rp, ep);
+        if(le - rp == sepsiz && !memcmp(rp, sepstr, sepsiz)) break;
+        rp = le + 1;
+      }
+      if(rp >= ep) return NULL;
+    }
+    rp = le + 1;
+  }
+  return NULL;
+}
+
+
+/* Evict the least recently used blocks from a block cache.
+   `cache' specifies the block cache object. */
+static void blockcachecut(BLOCKCACHE *cache){
+  assert(cache);
+  TCMAP *blocks = cache->blocks;
+  while(tcmaprnum(blocks) > BLOCKCACHEMAX ||
+        (tcmaprnum(blocks) > 1 && tcmapmsiz(blocks) > BLOCKCACHESIZ)){
+    tcmapcutfront(blocks, 1);
+  }
+}
+
+
+/* Add the text of a header into an outline.
+   `toc' specifies the outline.
+   `ptr' specifies the HTML of the header.
+   `size' specifies the size of the HTML. */
+static void tocappend(TCXSTR *toc, const char *ptr, int size){
+  assert(toc && ptr && size >= 0);
+  const char *ep = ptr + size;
+  bool tag = false;
+  while(ptr < ep){
+    int c = *(ptr++);
+    if(tag){
+      if(c == '>') tag = false;
+    } else if(c == '<'){
+      tag = true;
+    } else if(c == '\t' || c == '\r' || c == '\n'){
+      tcxstrcat(toc, " ", 1);
+    } else {
+      tcxstrcat(toc, ptr - 1, 1);
+    }
+  }
+}
+
+
+
+/* Calculate the hash value of a name.
+   `ptr' specifies the pointer to the region of the name.
+   `size' specifies the size of the region.
+   The return value is the FNV-1a hash value. */
+static uint64_t namehash(const void *ptr, int size){
+  assert(ptr && size >= 0);
+  const unsigned char *rp = ptr;
+  uint64_t hash = 14695981039346656037ULL;
+  while(size-- > 0){
+    hash = (hash ^ *(rp++)) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+
+/* Build the Bloom filter and the digest of a directory of article names.
+   `dir' specifies the directory object. */
+static void namedirindex(NAMEDIR *dir){
+  assert(dir);
+  int bnum = tclmax(tcmaprnum(dir->names) * NAMEBLOOMBITS, 64);
+  bnum = (bnum + 63) & ~63;
+  tcfree(dir->bloom);
+  dir->bloom = tccalloc(bnum / 64, sizeof(*dir->bloom));
+  dir->bnum = bnum;
+  uint64_t stamp = tcmaprnum(dir->names);
+  tcmapiterinit(dir->names);
+  const char *kbuf;
+  int ksiz;
+  while((kbuf = tcmapiternext(dir->names, &ksiz)) != NULL){
+    uint64_t hash = namehash(kbuf, ksiz);
+    uint64_t step = (hash >> 32) | 1;
+    for(int i = 0; i < NAMEBLOOMHASH; i++){
+      uint64_t bit = (hash + step * i) % bnum;
+      dir->bloom[bit>>6] |= 1ULL << (bit & 63);
+    }
+    int vsiz;
+    const char *vbuf = tcmapiterval(kbuf, &vsiz);
+    stamp += (hash ^ namehash(vbuf, vsiz)) * 0x9e3779b97f4a7c15ULL;
+  }
+  dir->stamp = stamp;
+}
+
+
+
+/* Update the link index for the modification of an article.
+   `path' specifies the path of the article database.
+   `id' specifies the ID number of the article.
+   `otext' specifies the old body text.  If it is `NULL', the article is new.
+   `ntext' specifies the new body text.  If it is `NULL', the article is removed.
+   If successful, the return value is true, else, it is false. */
+static bool dbputlinks(const char *path, int64_t id, const char *otext, const char *ntext){
+  assert(path && id > 0);
+  TCLIST *olinks = otext ? wikilinks(otext) : tclistnew();
+  TCLIST *nlinks = ntext ? wikilinks(ntext) : tclistnew();
+  char *lpath = tcsprintf("%s%s", path, LINKSUFFIX);
+  if(tclistnum(nlinks) < 1 && !tcstatfile(lpath, NULL, NULL, NULL)){
+    tcfree(lpath);
+    tclistdel(nlinks);
+    tclistdel(olinks);
+    return true;
+  }
+  bool err = false;
+  TCBDB *bdb = tcbdbnew();
+  if(tcbdbopen(bdb, lpath, BDBOWRITER | BDBOCREAT)){
+    TCMAP *keep = tcmapnew2(TINYBNUM);
+    TCXSTR *key = tcxstrnew();
+    for(int i = 0; i < tclistnum(nlinks); i++){
+      int lsiz;
+      const char *lbuf = tclistval(nlinks, i, &lsiz);
+      tcmapput(keep, lbuf, lsiz, "", 0);
+      tcxstrclear(key);
+      tcxstrcat(key, lbuf, lsiz);
+      tcxstrprintf(key, "\t%lld", (long long)id);
+      if(!tcbdbputkeep(bdb, tcxstrptr(key), tcxstrsize(key), "", 0) &&
+         tcbdbecode(bdb) != TCEKEEP) err = true;
+    }
+    for(int i = 0; i < tclistnum(olinks); i++){
+      int lsiz;
+      const char *lbuf = tclistval(olinks, i, &lsiz);
+      if(tcmapget(keep, lbuf, lsiz, &lsiz)) continue;
+      tcxstrclear(key);
+      tcxstrcat(key, lbuf, lsiz);
+      tcxstrprintf(key, "\t%lld", (long long)id);
+      if(!tcbdbout(bdb, tcxstrptr(key), tcxstrsize(key)) && tcbdbecode(bdb) != TCENOREC)
+        err = true;
+    }
+    tcxstrdel(key);
+    tcmapdel(keep);
+    if(!tcbdbclose(bdb)) err = true;
+  } else {
+    err = true;
+  }
+  tcbdbdel(bdb);
+  tcfree(lpath);
+  tclistdel(nlinks);
+  tclistdel(olinks);
+  return !err;
+}
+
+
+/* Get the name of the target article of a link.
+   `up' specifies the start of the URI part of the link.
+   `pv' specifies the end of the link.
+   `sep' specifies whether the link has the separator of the label.
+   The return value is the start of the name or `NULL' if the link is not to an article name. */
+static const char *linkname(const char *up, const char *pv, bool sep){
+  assert(up && pv);
+  if(spanfwm(up, pv, "name:")) return skipspc(up + 5, pv);
+  if(sep || spanfwm(up, pv, "id:") || spanfwm(up, pv, "param:") ||
+     spanfwm(up, pv, "upfile:") || spanfwm(up, pv, "wpen:") || spanfwm(up, pv, "wpja:") ||
+     spanfwm(up, pv, "http://") || spanfwm(up, pv, "https://") || spanfwm(up, pv, "ftp://") ||
+     spanfwm(up, pv, "mailto:")) return NULL;
+  return skipspc(up, pv);
+}
+
+
+
+/* Normalize the columns of an article without dumping and loading.
+   `ncols' specifies a map object into which the normalized columns are stored.
+   `cols' specifies a map object containing columns.
+   If successful, the return value is true.  False is returned if the columns contain data
+   which the round trip would change in other ways than squeezing and date formatting. */
+static bool wikinormfast(TCMAP *ncols, TCMAP *cols){
+  assert(ncols && cols);
+  const char *val = tcmapget2(cols, "id");
+  if(val){
+    if(strchr(val, '\n')) return false;
+    int64_t id = atoi(val);
+    if(id > 0) tcmapprintf(ncols, "id", "%lld", (long long)id);
+  }
+  int64_t xdate = INT64_MIN;
+  if(!normattr(ncols, cols, "name") || !normdate(ncols, cols, "cdate", &xdate) ||
+     !normdate(ncols, cols, "mdate", &xdate) || !normattr(ncols, cols, "owner") ||
+     !normattr(ncols, cols, "tags")) return false;
+  bool head = val || tcmapget2(cols, "name") || tcmapget2(cols, "cdate") ||
+    tcmapget2(cols, "mdate") || tcmapget2(cols, "owner") || tcmapget2(cols, "tags");
+  int tsiz;
+  const char *tbuf = tcmapget(cols, "text", 4, &tsiz);
+  if(!tbuf){
+    tbuf = "";
+    tsiz = 0;
+  }
+  if(tsiz > 0){
+    // the first line must start the body and the last line must be terminated just once
+    if((*tbuf >= '\0' && *tbuf <= ' ') || *tbuf == '#' || tbuf[tsiz-1] != '\n' ||
+       (tsiz > 1 && tbuf[tsiz-2] == '\n') || memchr(tbuf, '\r', tsiz) ||
+       memchr(tbuf, '\0', tsiz)) return false;
+    const char *rp = tbuf;
+    const char *ep = tbuf + tsiz;
+    while((rp = memchr(rp, '\n', ep - rp)) != NULL && ++rp < ep){
+      if(*rp == '#' && ep - rp > 1 && (rp[1] == ':' || rp[1] == '%')) return false;
+    }
+  }
+  tcmapput(ncols, "text", 4, tbuf, tsiz);
+  COMITER iter;
+  comiterinit(&iter, cols);
+  int cnum = 0;
+  while(comiternext(&iter)){
+    char numbuf[NUMBUFSIZ];
+    tcdatestrwww(iter.date, INT_MAX, numbuf);
+    if(tcstrmktime(numbuf) != iter.date || !normspan(iter.owner, iter.osiz) ||
+       memchr(iter.owner, '|', iter.osiz) || !normspan(iter.text, iter.tsiz)) return false;
+    if(iter.date > xdate) xdate = iter.date;
+    cnum++;
+  }
+  if(iter.rp != iter.ep) return false;
+  if(cnum > 0){
+    // comments just after the leading space are taken as the body
+    if(tsiz < 1 && !head) return false;
+    int csiz;
+    const char *cbuf = tcmapget(cols, "comments", 8, &csiz);
+    tcmapput(ncols, "comments", 8, cbuf, csiz);
+  }
+  if(xdate != INT64_MIN) tcmapprintf(ncols, "xdate", "%lld", (long long)xdate);
+  return true;
+}
+
+
+/* Normalize a text attribute of an article.
+   `ncols' specifies a map object into which the normalized attribute is stored.
+   `cols' specifies a map object containing columns.
+   `name' specifies the name of the attribute.
+   If successful, the return value is true, else, it is false. */
+static bool normattr(TCMAP *ncols, TCMAP *cols, const char *name){
+  assert(ncols && cols && name);
+  const char *val = tcmapget2(cols, name);
+  if(!val) return true;
+  if(strchr(val, '\n')) return false;
+  char *str = tcstrdup(val);
+  tcstrsqzspc(str);
+  if(*str != '\0') tcmapput2(ncols, name, str);
+  tcfree(str);
+  return true;
+}
+
+
+/* Normalize a date attribute of an article.
+   `ncols' specifies a map object into which the normalized attribute is stored.
+   `cols' specifies a map object containing columns.
+   `name' specifies the name of the attribute.
+   `xdp' specifies the pointer to the variable of the latest date.
+   If successful, the return value is true, else, it is false. */
+static bool normdate(TCMAP *ncols, TCMAP *cols, const char *name, int64_t *xdp){
+  assert(ncols && cols && name && xdp);
+  const char *val = tcmapget2(cols, name);
+  if(!val) return true;
+  char numbuf[NUMBUFSIZ];
+  tcdatestrwww(tcatoi(val), INT_MAX, numbuf);
+  int64_t date = tcstrmktime(numbuf);
+  if(date != INT64_MIN){
+    tcmapprintf(ncols, name, "%lld", (long long)date);
+    if(date > *xdp) *xdp = date;
+  }
+  return true;
+}
+
+
+/* Check whether a field of a comment is kept as it is by the round trip of the Wiki format.
+   `ptr' specifies the pointer to the region of the field.
+   `size' specifies the size of the region.
+   The return value is true if the field is a trimmed single line which is not empty. */
+static bool normspan(const char *ptr, int size){
+  assert(ptr && size >= 0);
+  if(size < 1 || (*ptr >= '\0' && *ptr <= ' ') || (ptr[size-1] >= '\0' && ptr[size-1] <= ' '))
+    return false;
+  return !memchr(ptr, '\n', size) && !memchr(ptr, '\r', size) && !memchr(ptr, '\0', size);
+}
+
+
+
+/* Make the key of a comment in the comment store.
+   `buf' specifies the result buffer.
+   `id' specifies the ID number of the article.
+   `date' specifies the date of the comment.
+   The return value is the size of the key. */
+static int comkey(char *buf, int64_t id, int64_t date){
+  assert(buf && id > 0);
+  return sprintf(buf, "%lld\t%015lld", (long long)id, (long long)tclmax(date, 0));
+}
+
+
+/* Collect the comments of an article to be matched with records of the comment store.
+   `id' specifies the ID number of the article.
+   `cols' specifies a map object of the columns of the article.
+   The return value is a map object whose keys are the keys of the records followed by a null
+   character and the owners, or `NULL' if the article has no comment.  Because the object of the
+   return value is allocated with the `malloc' call, it should be deleted with the `tcmapdel'
+   call when it is no longer in use. */
+static TCMAP *comrecs(int64_t id, TCMAP *cols){
+  assert(id > 0 && cols);
+  TCMAP *recs = NULL;
+  TCXSTR *rec = tcxstrnew();
+  COMITER iter;
+  comiterinit(&iter, cols);
+  while(comiternext(&iter)){
+    char kbuf[NUMBUFSIZ*2];
+    int ksiz = comkey(kbuf, id, iter.date);
+    tcxstrclear(rec);
+    tcxstrcat(rec, kbuf, ksiz + 1);
+    tcxstrcat(rec, iter.owner, iter.osiz);
+    if(!recs) recs = tcmapnew2(TINYBNUM);
+    tcmapput(recs, tcxstrptr(rec), tcxstrsize(rec), "", 0);
+  }
+  tcxstrdel(rec);
+  return recs;
+}
+
+
+/* Check whether a record of the comment store is one of collected comments.
+   `recs' specifies the map object returned by the function `comrecs'.
+   `kbuf' specifies the pointer to the region of the key of the record.
+   `ksiz' specifies the size of the region of the key.
+   `vbuf' specifies the pointer to the region of the value of the record.
+   `vsiz' specifies the size of the region of the value.
+   The return value is true if the record is in the map, else, it is false. */
+static bool comrecmatch(TCMAP *recs, const char *kbuf, int ksiz, const char *vbuf, int vsiz){
+  assert(recs && kbuf && ksiz >= 0 && vbuf && vsiz >= 0);
+  const char *ep = memchr(vbuf, '\0', vsiz);
+  if(!ep) return false;
+  int osiz = ep - vbuf;
+  char stack[LINEBUFSIZ];
+  char *rbuf = (ksiz + osiz + 1 <= sizeof(stack)) ? stack : tcmalloc(ksiz + osiz + 1);
+  memcpy(rbuf, kbuf, ksiz);
+  rbuf[ksiz] = '\0';
+  memcpy(rbuf + ksiz + 1, vbuf, osiz);
+  bool hit = tcmapget(recs, rbuf, ksiz + osiz + 1, &vsiz) != NULL;
+  if(rbuf != stack) tcfree(rbuf);
+  return hit;
+}
+
+
+/* Remove the comments of an article from the comment store.
+   `path' specifies the path of the article database.
+   `id' specifies the ID number of the article.
+   `cols' specifies a map object of the columns of the stored article.  Only the comments which
+   are in its column "comments" are removed, so that comments posted after the article was read
+   are kept.  If it is `NULL', all comments of the article are removed.
+   If successful, the return value is true, else, it is false. */
+static bool dboutcoms(const char *path, int64_t id, TCMAP *cols){
+  assert(path && id > 0);
+  TCMAP *recs = NULL;
+  if(cols){
+    recs = comrecs(id, cols);
+    if(!recs) return true;
+  }
+  char *cpath = tcsprintf("%s%s", path, COMSUFFIX);
+  bool exists = tcstatfile(cpath, NULL, NULL, NULL);
+  tcfree(cpath);
+  TCBDB *cdb = exists ? dbopencoms(path, true, false) : NULL;
+  if(!cdb){
+    if(recs) tcmapdel(recs);
+    return !exists;
+  }
+  bool err = false;
+  char pbuf[NUMBUFSIZ];
+  int psiz = sprintf(pbuf, "%lld\t", (long long)id);
+  BDBCUR *cur = tcbdbcurnew(cdb);
+  if(tcbdbcurjump(cur, pbuf, psiz)){
+    int ksiz, vsiz;
+    const char *kbuf, *vbuf;
+    while((kbuf = tcbdbcurkey3(cur, &ksiz)) != NULL && ksiz >= psiz &&
+          !memcmp(kbuf, pbuf, psiz)){
+      if(recs && (!(vbuf = tcbdbcurval3(cur, &vsiz)) ||
+                  !comrecmatch(recs, kbuf, ksiz, vbuf, vsiz))){
+        if(!tcbdbcurnext(cur)) break;
+      } else if(!tcbdbcurout(cur)){
+        err = true;
+        break;
+      }
+    }
+  }
+  tcbdbcurdel(cur);
+  if(!dbclosecoms(cdb)) err = true;
+  if(recs) tcmapdel(recs);
+  return !err;
+}
+
+
+
+/* Make the key of a revision in the revision store.
+   `buf' specifies the result buffer.
+   `id' specifies the ID number of the article.
+   `date' specifies the date of the revision.
+   The return value is the size of the key. */
+static int revkey(char *buf, int64_t id, int64_t date){
+  assert(buf && id > 0);
+  return sprintf(buf, "%lld\t%020lld", (long long)id, (long long)tclmax(date, 0));
+}
+
+
+/* Reconstruct a revision from the revision store.
+   `rdb' specifies the object of the revision store.
+   `id' specifies the ID number of the article.
+   `date' specifies the date of the revision.  If it is not more than 0, the latest revision is
+   reconstructed.
+   `datep' specifies the pointer to a variable into which the date of the revision is assigned.
+   If it is `NULL', it is not used.
+   `dnump' specifies the pointer to a variable into which the number of deltas since the last
+   snapshot is assigned.  If it is `NULL', it is not used.
+   If successful, the return value is the Wiki string of the revision, else, it is `NULL'.
+   Each value of the store is "S" followed by the whole string or "D" followed by the delta. */
+static char *revload(TCBDB *rdb, int64_t id, int64_t date, int64_t *datep, int *dnump){
+  assert(rdb && id > 0);
+  char pbuf[NUMBUFSIZ];
+  int psiz = sprintf(pbuf, "%lld\t", (long long)id);
+  char kbuf[NUMBUFSIZ];
+  int ksiz = date > 0 ? revkey(kbuf, id, date) : sprintf(kbuf, "%lld\t~", (long long)id);
+  BDBCUR *cur = tcbdbcurnew(rdb);
+  TCLIST *vals = tclistnew();
+  bool snap = false;
+  if(tcbdbcurjumpback(cur, kbuf, ksiz)){
+    TCXSTR *kxstr = tcxstrnew();
+    TCXSTR *vxstr = tcxstrnew();
+    while(!snap && tcbdbcurrec(cur, kxstr, vxstr)){
+      const char *rp = tcxstrptr(kxstr);
+      if(tcxstrsize(kxstr) < psiz || memcmp(rp, pbuf, psiz)) break;
+      if(tclistnum(vals) < 1){
+        if(date > 0 && (tcxstrsize(kxstr) != ksiz || memcmp(rp, kbuf, ksiz))) break;
+        if(datep) *datep = tcatoi(rp + psiz);
+      }
+      const char *vbuf = tcxstrptr(vxstr);
+      if(*vbuf == 'S') snap = true;
+      tclistpush(vals, vbuf, tcxstrsize(vxstr));
+      if(!snap && !tcbdbcurprev(cur)) break;
+    }
+    tcxstrdel(vxstr);
+    tcxstrdel(kxstr);
+  }
+  tcbdbcurdel(cur);
+  char *wiki = NULL;
+  if(snap){
+    int vnum = tclistnum(vals);
+    wiki = tcstrdup(tclistval2(vals, vnum - 1) + 1);
+    for(int i = vnum - 2; wiki && i >= 0; i--){
+      const char *vbuf = tclistval2(vals, i);
+      char *nwiki = *vbuf == 'D' ? revpatch(wiki, vbuf + 1) : NULL;
+      tcfree(wiki);
+      wiki = nwiki;
+    }
+    if(dnump) *dnump = vnum - 1;
+  }
+  tclistdel(vals);
+  return wiki;
+}
+
+
+/* Record a revision of an article into the revision store.
+   `path' specifies the path of the database.
+   `id' specifies the ID number of the article.
+   `wiki' specifies the Wiki string of the revision.
+   If successful, the return value is true, else, it is false.
+   A full snapshot is stored instead of a delta at every `REVSNAPNUM' revisions, and when the
+   delta would be larger than the string.  Nothing is stored if the string is unchanged. */
+static bool dbputrev(const char *path, int64_t id, const char *wiki){
+  assert(path && id > 0 && wiki);
+  char *rpath = tcsprintf("%s%s", path, REVSUFFIX);
+  TCBDB *rdb = tcbdbnew();
+  if(!tcbdbopen(rdb, rpath, BDBOWRITER | BDBOCREAT)){
+    tcbdbdel(rdb);
+    tcfree(rpath);
+    return false;
+  }
+  bool err = false;
+  int64_t odate = 0;
+  int dnum = 0;
+  char *owiki = revload(rdb, id, 0, &odate, &dnum);
+  if(!owiki || strcmp(owiki, wiki)){
+    int64_t date = tclmax(tctime() * 1000000, odate + 1);
+    char kbuf[NUMBUFSIZ];
+    int ksiz = revkey(kbuf, id, date);
+    int wsiz = strlen(wiki);
+    TCXSTR *rbuf = tcxstrnew3(wsiz + 2);
+    tcxstrcat(rbuf, "D", 1);
+    if(owiki && dnum + 1 < REVSNAPNUM){
+      TCLIST *olines = tcstrsplit(owiki, "\n");
+      TCLIST *nlines = tcstrsplit(wiki, "\n");
+      if(!revdiff(rbuf, olines, nlines) || tcxstrsize(rbuf) > wsiz) tcxstrclear(rbuf);
+      tclistdel(nlines);
+      tclistdel(olines);
+    } else {
+      tcxstrclear(rbuf);
+    }
+    if(tcxstrsize(rbuf) < 1){
+      tcxstrcat(rbuf, "S", 1);
+      tcxstrcat(rbuf, wiki, wsiz);
+    }
+    if(!tcbdbput(rdb, kbuf, ksiz, tcxstrptr(rbuf), tcxstrsize(rbuf))) err = true;
+    tcxstrdel(rbuf);
+  }
+  tcfree(owiki);
+  if(!tcbdbclose(rdb)) err = true;
+  tcbdbdel(rdb);
+  tcfree(rpath);
+  return !err;
+}
+
+
+/* Make a line-level delta between two lists of lines.
+   `rbuf' specifies the result buffer.
+   `olines' specifies the lines of the old string.
+   `nlines' specifies the lines of the new string.
+   If successful, the return value is true, else, it is false.  False is returned if the number
+   of edited lines exceeds `REVDIFFMAX'.
+   The delta is a sequence of commands: "=" followed by the number of copied lines, "-" followed
+   by the number of skipped lines, or "+" followed by the number of added lines and the lines.
+   The shortest edit script is calculated by the O(ND) algorithm of Myers. */
+static bool revdiff(TCXSTR *rbuf, const TCLIST *olines, const TCLIST *nlines){
+  assert(rbuf && olines && nlines);
+  int onum = tclistnum(olines);
+  int nnum = tclistnum(nlines);
+  int head = 0;
+  while(head < onum && head < nnum && revlineeq(olines, head, nlines, head)){
+    head++;
+  }
+  int tail = 0;
+  while(tail < onum - head && tail < nnum - head &&
+        revlineeq(olines, onum - tail - 1, nlines, nnum - tail - 1)){
+    tail++;
+  }
+  int n = onum - head - tail;
+  int m = nnum - head - tail;
+  int dmax = tclmin(n + m, REVDIFFMAX);
+  int off = dmax + 1;
+  int *vary = tccalloc(dmax * 2 + 3, sizeof(*vary));
+  // the diagonals of every step are kept to trace the path back
+  int tanum = 64;
+  int *trace = tcmalloc(tanum * sizeof(*trace));
+  int dend = -1;
+  for(int d = 0; d <= dmax && dend < 0; d++){
+    if(d * d + d * 4 + 3 > tanum){
+      tanum = tanum * 2 + d * 4 + 3;
+      trace = tcrealloc(trace, tanum * sizeof(*trace));
+    }
+    memcpy(trace + d * d + d * 2, vary + off - d - 1, (d * 2 + 3) * sizeof(*trace));
+    for(int k = -d; k <= d; k += 2){
+      int x = (k == -d || (k != d && vary[off+k-1] < vary[off+k+1])) ?
+        vary[off+k+1] : vary[off+k-1] + 1;
+      int y = x - k;
+      while(x < n && y < m && revlineeq(olines, head + x, nlines, head + y)){
+        x++;
+        y++;
+      }
+      vary[off+k] = x;
+      if(x >= n && y >= m){
+        dend = d;
+        break;
+      }
+    }
+  }
+  tcfree(vary);
+  if(dend < 0){
+    tcfree(trace);
+    return false;
+  }
+  char *oflags = tccalloc(n + m + 2, 1);
+  char *nflags = oflags + n + 1;
+  int x = n;
+  int y = m;
+  for(int d = dend; d >= 0; d--){
+    const int *tv = trace + d * d + d * 3 + 1;
+    int k = x - y;
+    int pk = (k == -d || (k != d && tv[k-1] < tv[k+1])) ? k + 1 : k - 1;
+    int px = tv[pk];
+    int py = px - pk;
+    while(x > px && y > py){
+      oflags[--x] = true;
+      nflags[--y] = true;
+    }
+    if(d > 0){
+      x = px;
+      y = py;
+    }
+  }
+  tcfree(trace);
+  if(head > 0) tcxstrprintf(rbuf, "=%d\n", head);
+  int i = 0;
+  int j = 0;
+  while(i < n || j < m){
+    if(i < n && j < m && oflags[i] && nflags[j]){
+      int num = 0;
+      while(i < n && j < m && oflags[i] && nflags[j]){
+        i++;
+        j++;
+        num++;
+      }
+      tcxstrprintf(rbuf, "=%d\n", num);
+    } else {
+      int num = 0;
+      while(i < n && !oflags[i]){
+        i++;
+        num++;
+      }
+      if(num > 0) tcxstrprintf(rbuf, "-%d\n", num);
+      int start = j;
+      while(j < m && !nflags[j]){
+        j++;
+      }
+      if(j > start){
+        tcxstrprintf(rbuf, "+%d\n", j - start);
+        for(int k = start; k < j; k++){
+          int lsiz;
+          const char *lbuf = tclistval(nlines, head + k, &lsiz);
+          tcxstrcat(rbuf, lbuf, lsiz);
+          tcxstrcat(rbuf, "\n", 1);
+        }
+      }
+    }
+  }
+  if(tail > 0) tcxstrprintf(rbuf, "=%d\n", tail);
+  tcfree(oflags);
+  return true;
+}
+
+
+/* Apply a line-level delta to a string.
+   `otext' specifies the old string.
+   `delta' specifies the delta made by the function `revdiff'.
+   If successful, the return value is the new string, else, it is `NULL'.
+   Because the region of the return value is allocated with the `malloc' call, it should be
+   released with the `free' call when it is no longer in use. */
+static char *revpatch(const char *otext, const char *delta){
+  assert(otext && delta);
+  TCLIST *olines = tcstrsplit(otext, "\n");
+  int onum = tclistnum(olines);
+  TCLIST *nlines = tclistnew2(onum + 1);
+  int oidx = 0;
+  bool err = false;
+  const char *rp = delta;
+  while(!err && *rp != '\0'){
+    int cmd = *rp;
+    int num = tcatoi(rp + 1);
+    const char *pv = strchr(rp, '\n');
+    if(!pv || num < 0){
+      err = true;
+      break;
+    }
+    rp = pv + 1;
+    switch(cmd){
+      case '=':
+        if(oidx + num > onum){
+          err = true;
+          break;
+        }
+        for(int i = 0; i < num; i++){
+          int lsiz;
+          const char *lbuf = tclistval(olines, oidx++, &lsiz);
+          tclistpush(nlines, lbuf, lsiz);
+        }
+        break;
+      case '-':
+        if(oidx + num > onum){
+          err = true;
+          break;
+        }
+        oidx += num;
+        break;
+      case '+':
+        for(int i = 0; !err && i < num; i++){
+          pv = strchr(rp, '\n');
+          if(pv){
+            tclistpush(nlines, rp, pv - rp);
+            rp = pv + 1;
+          } else {
+            err = true;
+          }
+        }
+        break;
+      default:
+        err = true;
+        break;
+    }
+  }
+  char *ntext = err || oidx != onum ? NULL : tcstrjoin(nlines, '\n');
+  tclistdel(nlines);
+  tclistdel(olines);
+  return ntext;
+}
+
+
+/* Check whether two lines are equal.
+   `olines' specifies the list of the first line.
+   `oidx' specifies the index of the first line.
+   `nlines' specifies the list of the second line.
+   `nidx' specifies the index of the second line.
+   The return value is true if they are equal, else, it is false. */
+static bool revlineeq(const TCLIST *olines, int oidx, const TCLIST *nlines, int nidx){
+  assert(olines && oidx >= 0 && nlines && nidx >= 0);
+  int osiz, nsiz;
+  const char *obuf = tclistval(olines, oidx, &osiz);
+  const char *nbuf = tclistval(nlines, nidx, &nsiz);
+  return osiz == nsiz && !memcmp(obuf, nbuf, osiz);
+}
+
+
+
+/* Check whether an article is hidden by the tag "?".
+   `cols' specifies a map object containing the columns of the article.
+   The return value is true if the article is hidden, else, it is false. */
+static bool arthidden(TCMAP *cols){
+  const char *rp = cols ? tcmapget2(cols, "tags") : NULL;
+  if(!rp) return false;
+  while(*rp != '\0'){
+    while(*rp == ' ' || *rp == ','){
+      rp++;
+    }
+    const char *pv = rp;
+    while(*pv != '\0' && *pv != ' ' && *pv != ','){
+      pv++;
+    }
+    if(pv == rp + 1 && *rp == '?') return true;
+    rp = pv;
+  }
+  return false;
+}
+
+
+/* Get the keys of the counter table for an article.
+   `id' specifies the ID number of the article.
+   `cols' specifies a map object containing the columns of the article.  If it is `NULL', no key
+   is generated.  "t:" followed by each tag and "a:" followed by the year and the month of the
+   creation date are generated unless the article is hidden by the tag "?".  "n:" followed by
+   the name, a tab, and the ID number is generated for every named article.
+   The return value is a map object whose keys are the keys of the counter table. */
+static TCMAP *cntkeys(int64_t id, TCMAP *cols){
+  TCMAP *keys = tcmapnew2(TINYBNUM);
+  bool hidden = arthidden(cols);
+  const char *tags = cols ? tcmapget2(cols, "tags") : NULL;
+  if(tags && !hidden){
+    // tags are split in the same way as the token index
+    TCXSTR *key = tcxstrnew();
+    const char *rp = tags;
+    while(*rp != '\0'){
+      while(*rp == ' ' || *rp == ','){
+        rp++;
+      }
+      const char *pv = rp;
+      while(*pv != '\0' && *pv != ' ' && *pv != ','){
+        pv++;
+      }
+      if(pv > rp){
+        tcxstrclear(key);
+        tcxstrcat(key, "t:", 2);
+        tcxstrcat(key, rp, pv - rp);
+        tcmapput(keys, tcxstrptr(key), tcxstrsize(key), "", 0);
+      }
+      rp = pv;
+    }
+    tcxstrdel(key);
+  }
+  const char *cdate = cols ? tcmapget2(cols, "cdate") : NULL;
+  if(cdate && !hidden){
+    // the month is in the local time as the date conditions of the search view
+    char numbuf[NUMBUFSIZ];
+    tcdatestrwww(tcstrmktime(cdate), INT_MAX, numbuf);
+    if(strlen(numbuf) >= 7){
+      char kbuf[NUMBUFSIZ];
+      int ksiz = sprintf(kbuf, "a:%.7s", numbuf);
+      tcmapput(keys, kbuf, ksiz, "", 0);
+    }
+  }
+  const char *name = cols ? tcmapget2(cols, "name") : NULL;
+  if(name && *name != '\0' && id > 0){
+    char *kbuf = tcsprintf("n:%s\t%lld", name, (long long)id);
+    tcmapput2(keys, kbuf, "");
+    tcfree(kbuf);
+  }
+  return keys;
+}
+
+
+/* Get the generation of the names in the counter table.
+   `path' specifies the path of the article database.
+   The return value is the generation or 0 if the counter table does not have it. */
+static int64_t dbnamegen(const char *path){
+  assert(path);
+  char *cpath = tcsprintf("%s%s", path, CNTSUFFIX);
+  int64_t gen = 0;
+  TCBDB *bdb = tcbdbnew();
+  if(tcstatfile(cpath, NULL, NULL, NULL) && tcbdbopen(bdb, cpath, BDBOREADER)){
+    int vsiz;
+    const char *vbuf = tcbdbget3(bdb, "g:names", 7, &vsiz);
+    if(vbuf && vsiz == sizeof(int)){
+      int num;
+      memcpy(&num, vbuf, sizeof(num));
+      gen = num;
+    }
+    tcbdbclose(bdb);
+  }
+  tcbdbdel(bdb);
+  tcfree(cpath);
+  return gen;
+}
+
+
+/* Update the counter table for an article.
+   `path' specifies the path of the article database.
+   `okeys' specifies a map object of the keys of the old article.  If it is `NULL', it is not used.
+   `nkeys' specifies a map object of the keys of the new article.  If it is `NULL', it is not used.
+   If successful, the return value is true, else, it is false.
+   The counts of keys only in the new one are incremented and those only in the old one are
+   decremented.  Records whose count reaches zero are removed. */
+static bool dbputcounts(const char *path, TCMAP *okeys, TCMAP *nkeys){
+  assert(path);
+  int onum = okeys ? tcmaprnum(okeys) : 0;
+  int nnum = nkeys ? tcmaprnum(nkeys) : 0;
+  if(onum < 1 && nnum < 1) return true;
+  char *cpath = tcsprintf("%s%s", path, CNTSUFFIX);
+  bool err = false;
+  TCBDB *bdb = tcbdbnew();
+  if(tcbdbopen(bdb, cpath, BDBOWRITER | BDBOCREAT)){
+    int ksiz, vsiz;
+    const char *kbuf;
+    bool names = false;
+    if(nkeys){
+      tcmapiterinit(nkeys);
+      while((kbuf = tcmapiternext(nkeys, &ksiz)) != NULL){
+        if(okeys && tcmapget(okeys, kbuf, ksiz, &vsiz)) continue;
+        if(tcbdbaddint(bdb, kbuf, ksiz, 1) == INT_MIN) err = true;
+        if(ksiz > 2 && !memcmp(kbuf, "n:", 2)) names = true;
+      }
+    }
+    if(okeys){
+      tcmapiterinit(okeys);
+      while((kbuf = tcmapiternext(okeys, &ksiz)) != NULL){
+        if(nkeys && tcmapget(nkeys, kbuf, ksiz, &vsiz)) continue;
+        if(ksiz > 2 && !memcmp(kbuf, "n:", 2)) names = true;
+        int num = tcbdbaddint(bdb, kbuf, ksiz, -1);
+        if(num == INT_MIN){
+          err = true;
+        } else if(num < 1 && !tcbdbout(bdb, kbuf, ksiz)){
+          err = true;
+        }
+      }
+    }
+    // the generation exists only if all names were counted by rebuilding the table
+    if(names && tcbdbget3(bdb, "g:names", 7, &vsiz) &&
+       tcbdbaddint(bdb, "g:names", 7, 1) == INT_MIN) err = true;
+    if(!tcbdbclose(bdb)) err = true;
+  } else {
+    err = true;
+  }
+  tcbdbdel(bdb);
+  tcfree(cpath);
+  return !err;
+}
+
+
+/* Append a comment to the recent comment table.
+   `bdb' specifies the object of the recent comment table.
+   `id' specifies the ID number of the article.
+   `date' specifies the date of the comment.
+   `owner' specifies the owner of the comment.
+   `text' specifies the text of the comment.  Only its excerpt is stored.
+   `rnum' specifies the maximum number of records of the table.
+   If successful, the return value is true, else, it is false.
+   The oldest records are removed so that the table has `rnum' records at most. */
+static bool recentput(TCBDB *bdb, int64_t id, int64_t date, const char *owner,
+                      const char *text, int rnum){
+  assert(bdb && id > 0 && owner && text && rnum > 0);
+  char kbuf[NUMBUFSIZ];
+  int ksiz = sprintf(kbuf, "%020lld", (long long)tclmax(date, 0));
+  if(tcbdbrnum(bdb) >= (uint64_t)rnum){
+    // a comment older than all of the full table would be removed at once
+    int osiz;
+    char *obuf = NULL;
+    BDBCUR *cur = tcbdbcurnew(bdb);
+    if(tcbdbcurfirst(cur)) obuf = tcbdbcurkey(cur, &osiz);
+    tcbdbcurdel(cur);
+    bool older = obuf && strcmp(kbuf, obuf) < 0;
+    tcfree(obuf);
+    if(older) return true;
+  }
+  // the excerpt is plain text cut by characters so that no markup or character is broken
+  TCXSTR *excerpt = tcxstrnew();
+  wikitotextinline(excerpt, text);
+  tcstrcututf((char *)tcxstrptr(excerpt), TINYTEXTLEN);
+  TCXSTR *value = tcxstrnew();
+  tcxstrprintf(value, "%lld", (long long)id);
+  tcxstrcat(value, "", 1);
+  tcxstrcat(value, owner, strlen(owner) + 1);
+  tcxstrcat2(value, tcxstrptr(excerpt));
+  bool err = false;
+  if(!tcbdbputdup(bdb, kbuf, ksiz, tcxstrptr(value), tcxstrsize(value))) err = true;
+  tcxstrdel(value);
+  tcxstrdel(excerpt);
+  BDBCUR *cur = tcbdbcurnew(bdb);
+  while(!err && tcbdbrnum(bdb) > (uint64_t)rnum){
+    if(!tcbdbcurfirst(cur) || !tcbdbcurout(cur)) err = true;
+  }
+  tcbdbcurdel(cur);
+  return !err;
+}
+
+
+/* Replace the comments of an article in the recent comment table.
+   `path' specifies the path of the article database.
+   `id' specifies the ID number of the article.
+   `cols' specifies a map object containing the columns of the article.  If it is `NULL' or the
+   article is hidden, the comments of the article are only removed.
+   If successful, the return value is true, else, it is false.
+   The number of records of the table is kept, so that it is not shrunk below the size which the
+   CGI script maintains. */
+static bool dbputrecent(const char *path, int64_t id, TCMAP *cols){
+  assert(path && id > 0);
+  char *rpath = tcsprintf("%s%s", path, RECENTSUFFIX);
+  if(!tcstatfile(rpath, NULL, NULL, NULL)){
+    tcfree(rpath);
+    return true;
+  }
+  bool err = false;
+  TCBDB *rdb = tcbdbnew();
+  if(tcbdbopen(rdb, rpath, BDBOWRITER)){
+    int rnum = tclmax(tcbdbrnum(rdb), RECENTNUM);
+    // the table is small enough to be scanned
+    BDBCUR *cur = tcbdbcurnew(rdb);
+    if(tcbdbcurfirst(cur)){
+      int vsiz;
+      const char *vbuf;
+      while((vbuf = tcbdbcurval3(cur, &vsiz)) != NULL){
+        if(tcatoi(vbuf) == id){
+          if(!tcbdbcurout(cur)){
+            err = true;
+            break;
+          }
+        } else if(!tcbdbcurnext(cur)){
+          break;
+        }
+      }
+    }
+    tcbdbcurdel(cur);
+    if(!err && cols && !arthidden(cols)){
+      COMITER iter;
+      comiterinit(&iter, cols);
+      while(comiternext(&iter)){
+        if(!recentput(rdb, id, iter.date, iter.owner, iter.text, rnum)) err = true;
+      }
+    }
+    if(!tcbdbclose(rdb)) err = true;
+  } else {
+    err = true;
+  }
+  tcbdbdel(rdb);
+  tcfree(rpath);
+  return !err;
+}
+
 
 // END OF FILE
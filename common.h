@@ -36,6 +36,8 @@ __COMMON_CLINKAGEBEGIN
 #include <limits.h>
 #include <math.h>
 #include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <tcutil.h>
 #include <tchdb.h>
 #include <tcbdb.h>
@@ -60,6 +62,53 @@ __COMMON_CLINKAGEBEGIN
 #define LINEBUFSIZ     1024              // size of a buffer for each line
 #define NUMBUFSIZ      64                // size of a buffer for number
 #define TINYBNUM       31                // bucket number of a tiny map
+#define TINYTEXTLEN    256               // number of characters of a tiny summary
+#define CACHESUFFIX    ".cache"          // suffix of the path of the rendering cache
+#define LINKSUFFIX     ".links"          // suffix of the path of the link index
+#define COMSUFFIX      ".coms"           // suffix of the path of the comment store
+#define REVSUFFIX      ".revs"           // suffix of the path of the revision store
+#define CNTSUFFIX      ".cnt"            // suffix of the path of the counter table
+#define RECENTSUFFIX   ".recent"         // suffix of the path of the recent comment table
+#define RECENTNUM      64                // default number of records of the recent comment table
+#define REVSNAPNUM     16                // number of revisions between full snapshots
+#define REVDIFFMAX     1024              // maximum number of edited lines of a delta
+#define CACHEVARMAX    8                 // maximum number of variants of each cached article
+#define BLOCKCACHEMAX  4096              // maximum number of records of a block cache
+#define BLOCKCACHESIZ  (16<<20)          // maximum size of a block cache
+#define BLOCKHASHSIZ   32                // size of the hash value of a block
+#define COMMAGIC       0x01              // magic byte of the binary format of comments
+#define PUBMANIFEST    "publish.manifest"  // name of the manifest of published articles
+#define ARCJOBNUM      4096              // number of articles of an archive handled at once
+#define IMPTRANNUM     1000              // default number of articles in each transaction of import
+#define NAMEBLOOMBITS  10                // number of bits of the Bloom filter for each name
+#define NAMEBLOOMHASH  4                 // number of hash functions of the Bloom filter
+
+typedef struct {                         // type of structure for a cache of rendered blocks
+  TCMAP *blocks;                         // rendered blocks in the LRU order
+  int64_t hits;                          // number of cache hits
+  int64_t misses;                        // number of cache misses
+  int lastnum;                           // number of blocks used by the last conversion
+} BLOCKCACHE;
+
+typedef struct {                         // type of structure for a directory of article names
+  TCMAP *names;                          // map of names and ID numbers
+  uint64_t *bloom;                       // bit array of the Bloom filter
+  int bnum;                              // number of bits of the Bloom filter
+  uint64_t stamp;                        // digest of the set of names
+  int64_t gen;                           // generation of the loaded names
+  TCTDB *tdb;                            // database looked up on demand
+  bool pub;                              // whether to link to published files
+} NAMEDIR;
+
+typedef struct {                         // type of structure for an iterator of comments
+  const char *rp;                        // current position
+  const char *ep;                        // end of the region
+  int64_t date;                          // date of the current comment
+  const char *owner;                     // owner of the current comment
+  int osiz;                              // size of the owner
+  const char *text;                      // text of the current comment
+  int tsiz;                              // size of the text
+} COMITER;
 
 enum {                                   // enumeration for external data formats
   FMTWIKI,                               // Wiki
@@ -80,6 +129,17 @@ void wikiload(TCMAP *cols, const char *str);
 void wikidump(TCXSTR *rbuf, TCMAP *cols);
 
 
+/* Normalize the columns of an article.
+   `cols' specifies a map object containing columns.  Comments in the old text format in it are
+   converted into the binary format.
+   The return value is a map object of the normalized columns, which is the same as the result
+   of loading the Wiki string dumped from the columns.  Columns which are already normalized
+   are copied without dumping and loading.
+   Because the object of the return value is created with the function `tcmapnew', it should be
+   deleted with the function `tcmapdel' when it is no longer in use. */
+TCMAP *wikinormalize(TCMAP *cols);
+
+
 /* Dump the attributes and the body text of an article into a plain text string.
    `rbuf' specifies the result buffer.
    `cols' specifies a map object containing columns. */
@@ -92,6 +152,24 @@ void wikidumptext(TCXSTR *rbuf, TCMAP *cols);
 void wikitotext(TCXSTR *rbuf, const char *str);
 
 
+/* Convert a Wiki string into a tiny summary in plain text.
+   `str' specifies the Wiki string.
+   The return value is the summary string, which is normalized in white spaces and cut down to
+   `TINYTEXTLEN' characters.
+   Because the region of the return value is allocated with the `malloc' call, it should be
+   released with the `free' call when it is no longer in use. */
+char *wikitotiny(const char *str);
+
+
+/* Extract the targets of the links to articles in a Wiki string.
+   `str' specifies the Wiki string.
+   The return value is a list object of the targets without duplication.  Each element is "id:"
+   followed by the ID number or "name:" followed by the name of the target article.
+   Because the object of the return value is created with the function `tclistnew', it should
+   be deleted with the function `tclistdel' when it is no longer in use. */
+TCLIST *wikilinks(const char *str);
+
+
 /* Add an inline Wiki string into plain text.
    `rbuf' specifies the result buffer.
    `line' specifies the inline Wiki string. */
@@ -118,12 +196,129 @@ void wikitohtml(TCXSTR *rbuf, const char *str, const char *id, const char *buri,
                 const char *duri);
 
 
+/* Convert a Wiki string into an HTML string with a block cache and an outline.
+   `rbuf' specifies the result buffer.
+   `str' specifies the Wiki string.
+   `id' specifies the ID string of the article.  If it is `NULL', the ID is not expressed.
+   `buri' specifies the base URI.
+   `bhl' specifies the base header level.
+   `duri' specifie the URI of the data directory.
+   `cache' specifies the block cache.  If it is `NULL', no cache is used.
+   `toc' specifies the buffer of the outline.  If it is `NULL', the outline is not produced.
+   `names' specifies the directory of article names.  If it is not `NULL', links to names which
+   are not in it are expressed as links to the edit form of the class "missing".  If its member
+   `pub' is true, links to existing articles are expressed as links to the files "ID.html".
+   The text is divided into sections by empty lines.  The HTML of each section is reused if the
+   same section was converted in the same context before.
+   Each header is added into the outline as a line of the level relative to the article, the ID
+   attribute, and the escaped text without tags, separated by tabs. */
+void wikitohtml2(TCXSTR *rbuf, const char *str, const char *id, const char *buri, int bhl,
+                 const char *duri, BLOCKCACHE *cache, TCXSTR *toc, NAMEDIR *names);
+
+
 /* Add an inline Wiki string into HTML.
    `rbuf' specifies the result buffer.
    `line' specifies the inline Wiki string.
    `buri' specifies the base URI.
-   `duri' specifie the URI of the data directory. */
-void wikitohtmlinline(TCXSTR *rbuf, const char *line, const char *buri, const char *duri);
+   `duri' specifie the URI of the data directory.
+   `names' specifies the directory of article names.  If it is `NULL', links are not checked.
+   Links are expressed in the same way as the function `wikitohtml2'. */
+void wikitohtmlinline(TCXSTR *rbuf, const char *line, const char *buri, const char *duri,
+                      NAMEDIR *names);
+
+
+/* Create a block cache object.
+   The return value is the new block cache object.
+   Because the object of the return value is allocated with the `malloc' call, it should be
+   deleted with the function `blockcachedel' when it is no longer in use. */
+BLOCKCACHE *blockcachenew(void);
+
+
+/* Delete a block cache object.
+   `cache' specifies the block cache object. */
+void blockcachedel(BLOCKCACHE *cache);
+
+
+/* Serialize the blocks used by the last conversion with a block cache.
+   `cache' specifies the block cache object.
+   `sp' specifies the pointer to the variable into which the size of the region of the return
+   value is assigned.
+   The return value is the pointer to the region of the result serial region.
+   Because the region of the return value is allocated with the `malloc' call, it should be
+   released with the `free' call when it is no longer in use. */
+void *blockcachedump(BLOCKCACHE *cache, int *sp);
+
+
+/* Add serialized blocks into a block cache.
+   `cache' specifies the block cache object.
+   `ptr' specifies the pointer to the region of serialized blocks.
+   `size' specifies the size of the region. */
+void blockcacheload(BLOCKCACHE *cache, const void *ptr, int size);
+
+
+/* Create a directory of article names.
+   The return value is the new directory object, which is empty.
+   Because the object of the return value is allocated inside the function, it should be
+   deleted with the function `namedirdel' when it is no longer in use. */
+NAMEDIR *namedirnew(void);
+
+
+/* Delete a directory of article names.
+   `dir' specifies the directory object. */
+void namedirdel(NAMEDIR *dir);
+
+
+/* Load the names of every article into a directory.
+   `dir' specifies the directory object.
+   `tdb' specifies the article database.
+   If successful, the return value is true, else, it is false.
+   The names are read from the counter table, which is described in the function `dbgetcounts'.
+   Nothing is done if the generation of the names in the counter table has not changed since the
+   last loading.  If the counter table does not have the names, the directory is set to look up
+   the database with the function `namedirsetdb' instead. */
+bool namedirload(NAMEDIR *dir, TCTDB *tdb);
+
+
+/* Make a directory of article names look up the name index of a database.
+   `dir' specifies the directory object.
+   `tdb' specifies the article database.  It should be kept open while the directory is used.
+   The loaded names are discarded.  Each name is looked up with a query on the column "name"
+   when it is asked for the first time.  If the counter table does not have the generation of the
+   names, the stamp of the directory is derived from the modification time and the number of
+   records of the database. */
+void namedirsetdb(NAMEDIR *dir, TCTDB *tdb);
+
+
+/* Get the ID number of an article in a directory of article names.
+   `dir' specifies the directory object.
+   `ptr' specifies the pointer to the region of the name.
+   `size' specifies the size of the region.
+   The return value is the ID number of an article of the name or 0 if no article has it. */
+int64_t namedirget(NAMEDIR *dir, const void *ptr, int size);
+
+
+/* Initialize an iterator of the comments of an article.
+   `iter' specifies the iterator object.
+   `cols' specifies a map object containing columns.
+   If the comments are in the legacy text format of "date|owner|text" lines, they are converted
+   into the binary format in the map object beforehand.  The iterator refers to the region of the
+   column, which should not be modified while the iterator is in use. */
+void comiterinit(COMITER *iter, TCMAP *cols);
+
+
+/* Get the next comment of an iterator of comments.
+   `iter' specifies the iterator object.
+   If successful, the return value is true and the members `date', `owner', `osiz', `text', and
+   `tsiz' are set, else, it is false.  The owner and the text are terminated by a zero code. */
+bool comiternext(COMITER *iter);
+
+
+/* Add a comment into the comments of an article.
+   `cols' specifies a map object containing columns.
+   `date' specifies the date of the comment.
+   `owner' specifies the owner of the comment.
+   `text' specifies the text of the comment. */
+void comadd(TCMAP *cols, int64_t date, const char *owner, const char *text);
 
 
 /* Simplify a date string.
@@ -132,6 +327,33 @@ void wikitohtmlinline(TCXSTR *rbuf, const char *line, const char *buri, const ch
 char *datestrsimple(char *str);
 
 
+/* Set the template variables of the attributes of an article.
+   `cols' specifies a map object containing columns.
+   The dates are formatted in the W3CDTF with the simple forms in "cdatesimple", "mdatesimple",
+   and "xdatesimple", and the tags are split into the list "taglist". */
+void artsetattrs(TCMAP *cols);
+
+
+/* Set the template variable of the outline of an article.
+   `cols' specifies a map object containing columns.
+   `ptr' specifies the pointer to the region of the outline generated by `wikitohtml2'.
+   `size' specifies the size of the region.
+   The headings are stored into the list "toc" if any. */
+void artsettoc(TCMAP *cols, const char *ptr, int size);
+
+
+/* Set the template variables of the comments of an article.
+   `cols' specifies a map object containing columns.
+   `buri' specifies the base URI.
+   `duri' specifies the URI of the upload directory.  If it is `NULL', it is not used.
+   `names' specifies the directory of article names.  If it is `NULL', it is not used.
+   `htmls' specifies a map object of the HTML data of the comments keyed by "c" and the order
+   number.  Missing data are generated and stored into it.  If it is `NULL', it is not used.
+   The comments are stored into the list "comments" and the number of them into "comnum".
+   The return value is the number of the comments. */
+int artsetcoms(TCMAP *cols, const char *buri, const char *duri, NAMEDIR *names, TCMAP *htmls);
+
+
 /* Get the MIME type of a file.
    `name' specifies the name of the file.
    The return value is the MIME type of the file or `NULL' if the type is not detected. */
@@ -148,7 +370,7 @@ const char *mimetypename(const char *type);
    `str' specifies the string.
    The return value is the result string.
    Because the region of the return value is allocated with the `malloc' call, it should be
-   released with the `free' call if when is no longer in use. */
+   released with the `free' call when it is no longer in use. */
 char *pathencode(const char *str);
 
 
@@ -156,11 +378,32 @@ char *pathencode(const char *str);
    `tdb' specifies the database object.
    `id' specifies the ID number of the article.  If it is not more than 0, the auto-increment ID
    is assigned.
-   `cols' specifies a map object containing columns.
+   `cols' specifies a map object containing columns.  The derived column "texttiny" is
+   calculated from the text and stored together.  After the transaction is committed, the
+   article is also recorded as a new revision in the revision store unless it is unchanged, and
+   the counter table and the recent comment table are updated.
    If successful, the return value is true, else, it is false. */
 bool dbputart(TCTDB *tdb, int64_t id, TCMAP *cols);
 
 
+/* Store an article into the database in the bulk mode or not.
+   `tdb' specifies the database object.
+   `id' specifies the ID number of the article.  If it is not more than 0, the auto-increment ID
+   is assigned.
+   `cols' specifies a map object containing columns.
+   `bulk' specifies whether to store it in the bulk mode.  If it is true, the article is stored
+   without beginning a transaction, and the rendering cache, the link index, the revision store,
+   and the counter table are not updated.
+   The caller should then commit the transaction, remove the rendering cache, and rebuild the
+   link index and the counter table with the functions `dbbuildlinks' and `dbbuildcounts' by
+   itself.  No revision is recorded for an article stored in the bulk mode, so its history
+   starts at the next update.  Comments in the comment store which are also in the column
+   "comments" of `cols' are removed in the normal mode.  In the bulk mode, the caller should
+   remove them at once with the function `dbcleancoms'.
+   If successful, the return value is true, else, it is false. */
+bool dbputart2(TCTDB *tdb, int64_t id, TCMAP *cols, bool bulk);
+
+
 /* Remove an article from the database.
    `tdb' specifies the database object.
    `id' specifies the ID number of the article.
@@ -168,14 +411,216 @@ bool dbputart(TCTDB *tdb, int64_t id, TCMAP *cols);
 bool dboutart(TCTDB *tdb, int64_t id);
 
 
+/* Rebuild the link index of all articles in the database.
+   `tdb' specifies the database object.
+   If successful, the return value is true, else, it is false. */
+bool dbbuildlinks(TCTDB *tdb);
+
+
+/* Rebuild the counter table of all articles in the database.
+   `tdb' specifies the database object.
+   If successful, the return value is true, else, it is false. */
+bool dbbuildcounts(TCTDB *tdb);
+
+
+/* Rebuild the recent comment table of all articles in the database.
+   `tdb' specifies the database object.
+   `rnum' specifies the maximum number of records of the recent comment table.  If it is not
+   more than 0, the current number of records is kept, but it is `RECENTNUM' at least.
+   If successful, the return value is true, else, it is false. */
+bool dbbuildrecent(TCTDB *tdb, int rnum);
+
+
+/* Remove the comments which are stored in the articles from the comment store.
+   `tdb' specifies the database object.
+   Each record of the comment store is removed if the column "comments" of the article has the
+   comment of the same date and the same owner.  Comments posted after the articles were exported
+   are kept.
+   If successful, the return value is true, else, it is false. */
+bool dbcleancoms(TCTDB *tdb);
+
+
+/* Retrieve counts of articles from the counter table.
+   `path' specifies the path of the article database.  The counter table is the B+ tree database
+   whose path is that of the article database followed by `CNTSUFFIX'.  Its keys are composed of
+   a prefix of the kind and a name, and each value is the number of articles.  "t:" followed by
+   a tag is counted for each tag of the column "tags", and "a:" followed by "YYYY-MM" is counted
+   for the month of the creation date in the local time, except for articles tagged with "?".
+   "n:" followed by a name, a tab, and an ID number is counted for each named article, and
+   "g:names" is the generation which is incremented whenever such a key is added or removed.
+   The generation is created only when the table is rebuilt with all names.
+   It is maintained by the functions `dbputart' and `dboutart'.
+   `prefix' specifies the prefix of the kind.
+   The return value is a map object of names without the prefix and decimal strings of the
+   counts, in the ascending order of the names.
+   Because the object of the return value is created with the function `tcmapnew', it should be
+   deleted with the function `tcmapdel' when it is no longer in use. */
+TCMAP *dbgetcounts(const char *path, const char *prefix);
+
+
+/* Retrieve the ID numbers of articles linking to an article.
+   `path' specifies the path of the article database.  The link index is the B+ tree database
+   whose path is that of the article database followed by `LINKSUFFIX'.  It is maintained by
+   the functions `dbputart' and `dboutart'.
+   `id' specifies the ID number of the target article.  If it is not more than 0, it is ignored.
+   `name' specifies the name of the target article.  If it is `NULL', it is ignored.
+   The return value is a list object of the ID numbers of the source articles in ascending
+   order.  The target article itself is excluded.
+   Because the object of the return value is created with the function `tclistnew', it should
+   be deleted with the function `tclistdel' when it is no longer in use. */
+TCLIST *dbgetbacklinks(const char *path, int64_t id, const char *name);
+
+
 /* Retrieve an article of the database.
    `tdb' specifies the database object.
    `id' specifies the ID number.
+   If successful, the return value is a map object of the columns.  Comments in the comment
+   store are appended to the column "comments".  `NULL' is returned if no article corresponds.
+   Because the object of the return value is created with the function `tcmapnew', it should be
+   deleted with the function `tcmapdel' when it is no longer in use. */
+TCMAP *dbgetart(TCTDB *tdb, int64_t id);
+
+
+/* Retrieve an article of the database with an opened comment store.
+   `tdb' specifies the database object.
+   `cdb' specifies the object of the comment store opened by the function `dbopencoms'.  If it
+   is `NULL', comments in the comment store are not retrieved.
+   `id' specifies the ID number.
    If successful, the return value is a map object of the columns.  `NULL' is returned if no
    article corresponds.
    Because the object of the return value is created with the function `tcmapnew', it should be
    deleted with the function `tcmapdel' when it is no longer in use. */
-TCMAP *dbgetart(TCTDB *tdb, int64_t id);
+TCMAP *dbgetart2(TCTDB *tdb, TCBDB *cdb, int64_t id);
+
+
+/* Open the comment store of the database.
+   `path' specifies the path of the article database.  The comment store is the B+ tree
+   database whose path is that of the article database followed by `COMSUFFIX'.  Its keys are
+   composed of the ID number of the article and the date, and the duplicated records of each key
+   are kept in the order of posting.
+   `wmode' specifies whether to open it as a writer.  If it is false and the comment store does
+   not exist, `NULL' is returned.
+   `mutex' specifies whether the object is shared by threads.
+   If successful, the return value is the object of the comment store, else, it is `NULL'.
+   The object should be closed with the function `dbclosecoms'. */
+TCBDB *dbopencoms(const char *path, bool wmode, bool mutex);
+
+
+/* Close the comment store of the database.
+   `cdb' specifies the object of the comment store.
+   If successful, the return value is true, else, it is false. */
+bool dbclosecoms(TCBDB *cdb);
+
+
+/* Append the stored comments of an article to its columns.
+   `cdb' specifies the object of the comment store.
+   `id' specifies the ID number of the article.
+   `cols' specifies a map object containing the columns of the article.
+   The return value is the number of the appended comments. */
+int dbgetcoms(TCBDB *cdb, int64_t id, TCMAP *cols);
+
+
+/* Get the dates of the revisions of an article.
+   `path' specifies the path of the database.  The revision store is the B+ tree database whose
+   path is that of the database followed by `REVSUFFIX'.  Its keys are composed of the ID number
+   of the article and the date in microseconds, and each value is either the full Wiki string
+   of the revision or a line-level delta against the previous revision.
+   `id' specifies the ID number of the article.
+   The return value is a list object of the dates of the revisions in ascending order.
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use. */
+TCLIST *dbgetrevs(const char *path, int64_t id);
+
+
+/* Retrieve a revision of an article.
+   `path' specifies the path of the database.
+   `id' specifies the ID number of the article.
+   `date' specifies the date of the revision.  If it is not more than 0, the latest revision is
+   retrieved.
+   If successful, the return value is the Wiki string of the revision.  `NULL' is returned if no
+   revision corresponds.
+   Because the region of the return value is allocated with the `malloc' call, it should be
+   released with the `free' call when it is no longer in use. */
+char *dbgetrev(const char *path, int64_t id, int64_t date);
+
+
+/* Post a comment to an article of the database.
+   `tdb' specifies the database object.
+   `id' specifies the ID number of the article.
+   `date' specifies the date of the comment.
+   `owner' specifies the owner of the comment.
+   `text' specifies the text of the comment.
+   `rnum' specifies the maximum number of records of the recent comment table.  If it is not
+   more than 0, the recent comment table is not updated.
+   If successful, the return value is true, else, it is false.
+   The comment is appended to the comment store and the column "xdate" of the article is
+   updated, so that the other columns and their indexes are not rewritten.  Unless the article
+   is hidden by the tag "?", the comment is also appended to the recent comment table, whose
+   oldest records are removed so that it has `rnum' records at most. */
+bool dbputcom(TCTDB *tdb, int64_t id, int64_t date, const char *owner, const char *text,
+              int rnum);
+
+
+/* Retrieve the latest comments from the recent comment table.
+   `path' specifies the path of the article database.  The recent comment table is the B+ tree
+   database whose path is that of the article database followed by `RECENTSUFFIX'.  Its keys are
+   the dates of comments and each value is composed of the ID number of the article, the owner,
+   and the excerpt of the text.  The excerpt is the text converted into plain text and cut at
+   `TINYTEXTLEN' characters.  It is maintained by the functions `dbputcom' and `dboutart'.
+   `max' specifies the maximum number of retrieved comments.
+   The return value is a list object of the serialized maps of the comments in the descending
+   order of the dates.  Each map has the keys "id", "date", "owner", and "text".
+   Because the object of the return value is created with the function `tclistnew', it should be
+   deleted with the function `tclistdel' when it is no longer in use. */
+TCLIST *dbgetrecent(const char *path, int max);
+
+
+/* Retrieve the rendered data of an article from the rendering cache.
+   `path' specifies the path of the article database.  The cache is the hash database whose
+   path is that of the article database followed by `CACHESUFFIX'.
+   `id' specifies the ID number of the article.
+   `cols' specifies a map object containing the stored columns of the article.
+   `variant' specifies the string identifying the rendering parameters.
+   If successful, the return value is a map object of the rendered data.  `NULL' is returned if
+   no data corresponds or if the data is older than the columns.
+   Because the object of the return value is created with the function `tcmapnew', it should be
+   deleted with the function `tcmapdel' when it is no longer in use. */
+TCMAP *dbgetcache(const char *path, int64_t id, TCMAP *cols, const char *variant);
+
+
+/* Store the rendered data of an article into the rendering cache.
+   `path' specifies the path of the article database.
+   `id' specifies the ID number of the article.
+   `cols' specifies a map object containing the stored columns of the article.
+   `variant' specifies the string identifying the rendering parameters.
+   `data' specifies a map object of the rendered data.
+   If successful, the return value is true, else, it is false. */
+bool dbputcache(const char *path, int64_t id, TCMAP *cols, const char *variant, TCMAP *data);
+
+
+/* Load the rendered blocks of an article from the rendering cache.
+   `path' specifies the path of the article database.
+   `id' specifies the ID number of the article.
+   `cache' specifies the block cache object into which the blocks are added.
+   If successful, the return value is true, else, it is false. */
+bool dbgetblocks(const char *path, int64_t id, BLOCKCACHE *cache);
+
+
+/* Store the blocks used by the last conversion of an article into the rendering cache.
+   `path' specifies the path of the article database.
+   `id' specifies the ID number of the article.
+   `cache' specifies the block cache object.
+   If successful, the return value is true, else, it is false. */
+bool dbputblocks(const char *path, int64_t id, BLOCKCACHE *cache);
+
+
+/* Remove the rendered data of an article from the rendering cache.
+   `path' specifies the path of the article database.
+   `id' specifies the ID number of the article.
+   `blocks' specifies whether to remove the rendered blocks too.
+   If successful, the return value is true, else, it is false.  It is not an error that the
+   cache does not exist. */
+bool dboutcache(const char *path, int64_t id, bool blocks);
 
 
 /* Generate the hash value of a user password.
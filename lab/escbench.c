@@ -0,0 +1,128 @@
+/*************************************************************************************************
+ * Differential test and benchmark of the escaping scanners
+ * Build it at the top of the source tree as follows.
+ *   gcc -std=c99 -O2 -I. -D_GNU_SOURCE=1 -o escbench lab/escbench.c \
+ *     -ltokyocabinet -lz -lbz2 -lpthread -lm
+ *************************************************************************************************/
+
+
+#include "common.c"
+
+#define TESTNUM        100000            // number of random regions to be tested
+#define TESTSIZMAX     200               // maximum size of each random region
+#define BENCHSIZ       (8<<20)           // size of the region to be benchmarked
+
+
+/* global variables */
+const char *g_progname;                  // program name
+
+
+/* function prototypes */
+int main(int argc, char **argv);
+static bool checkscan(const char *ptr, const char *ep, int mode);
+static double benchscan(const char *name, const char *(*func)(const char *, const char *, int),
+                        const char *ptr, int size, int mode);
+
+
+/* main routine */
+int main(int argc, char **argv){
+  g_progname = argv[0];
+  int loopnum = argc > 1 ? tcatoi(argv[1]) : 20;
+  if(loopnum < 1) loopnum = 1;
+  const char chars[] = "abcdefghijklmnopqrstuvwxyz &<>\"[]\t\r\n\x01\x1f\x7f\x80\xe3\xff";
+  int cnum = sizeof(chars) - 1;
+  char *buf = tcmalloc(TESTSIZMAX + 1);
+  int err = 0;
+  for(int i = 0; i < TESTNUM; i++){
+    int size = rand() % (TESTSIZMAX + 1);
+    int sparse = rand() % 8 + 1;
+    for(int j = 0; j < size; j++){
+      buf[j] = rand() % sparse == 0 ? chars[rand() % cnum] : 'a' + rand() % 26;
+    }
+    int off = size > 0 ? rand() % size : 0;
+    for(int mode = 1; mode <= (ESCMETA | ESCCTRL | ESCBRACKET); mode++){
+      if(!checkscan(buf + off, buf + size, mode)) err++;
+    }
+  }
+  tcfree(buf);
+  printf("differential test: %d regions, %d errors\n", TESTNUM, err);
+  buf = tcmalloc(BENCHSIZ + 1);
+  for(int i = 0; i < BENCHSIZ; i++){
+    buf[i] = (i % 97 == 96) ? '&' : 'a' + i % 26;
+  }
+  buf[BENCHSIZ] = '\0';
+  for(int i = 0; i < loopnum / 10 + 1; i++){
+    escscanplain(buf, buf + BENCHSIZ, ESCMETA);
+  }
+  double base = benchscan("plain", escscanplain, buf, BENCHSIZ, ESCMETA | ESCBRACKET);
+#if defined(ESCSIMD)
+  double sse2 = benchscan("sse2", escscansse2, buf, BENCHSIZ, ESCMETA | ESCBRACKET);
+  printf("sse2 speedup: %.2f\n", base / sse2);
+  if(__builtin_cpu_supports("avx2")){
+    double avx2 = benchscan("avx2", escscanavx2, buf, BENCHSIZ, ESCMETA | ESCBRACKET);
+    printf("avx2 speedup: %.2f\n", base / avx2);
+  }
+#endif
+  TCXSTR *rbuf = tcxstrnew3(BENCHSIZ * 2);
+  double stime = tctime();
+  for(int i = 0; i < loopnum; i++){
+    tcxstrclear(rbuf);
+    htmlescape(rbuf, buf, BENCHSIZ);
+  }
+  double etime = tctime();
+  printf("htmlescape: %.3f MB/s\n", (double)BENCHSIZ * loopnum / (etime - stime) / (1 << 20));
+  tcxstrclear(rbuf);
+  stime = tctime();
+  for(int i = 0; i < loopnum; i++){
+    tcxstrclear(rbuf);
+    tcxstrprintf(rbuf, "%@", buf + BENCHSIZ - (BENCHSIZ >> 2));
+  }
+  etime = tctime();
+  printf("tcxstrprintf: %.3f MB/s\n",
+         (double)(BENCHSIZ >> 2) * loopnum / (etime - stime) / (1 << 20));
+  tcxstrdel(rbuf);
+  tcfree(buf);
+  return err > 0 ? 1 : 0;
+}
+
+
+/* check the result of every scanner */
+static bool checkscan(const char *ptr, const char *ep, int mode){
+  const char *exp = ptr;
+  while(exp < ep && !(esctable[*(unsigned char *)exp] & mode)){
+    exp++;
+  }
+  bool ok = true;
+  if(escscanplain(ptr, ep, mode) != exp) ok = false;
+  if(escscan(ptr, ep, mode) != exp) ok = false;
+#if defined(ESCSIMD)
+  if(escscansse2(ptr, ep, mode) != exp) ok = false;
+  if(__builtin_cpu_supports("avx2") && escscanavx2(ptr, ep, mode) != exp) ok = false;
+#endif
+  if(!ok)
+    fprintf(stderr, "%s: mismatch: mode=%d size=%d\n", g_progname, mode, (int)(ep - ptr));
+  return ok;
+}
+
+
+/* measure the throughput of a scanner */
+static double benchscan(const char *name, const char *(*func)(const char *, const char *, int),
+                        const char *ptr, int size, int mode){
+  const char *ep = ptr + size;
+  long cnt = 0;
+  double stime = tctime();
+  for(int i = 0; i < 20; i++){
+    const char *rp = ptr;
+    while((rp = func(rp, ep, mode)) < ep){
+      cnt++;
+      rp++;
+    }
+  }
+  double etime = tctime() - stime;
+  printf("%s: %.3f MB/s (%ld hits)\n", name, (double)size * 20 / etime / (1 << 20), cnt);
+  return etime;
+}
+
+
+
+// END OF FILE
@@ -15,6 +15,9 @@
 
 #include "common.h"
 #include "scrext.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
 #if defined(MYFCGI)
 #include <fcgi_stdio.h>
 #endif
@@ -23,14 +26,6 @@
 #define RIDDLENAME     "[riddle]"        // dummy user name of the riddle
 #define ADMINNAME      "admin"           // user name of the administrator
 
-typedef struct {                         // type of structure for a record
-  int64_t id;                            // ID of the article
-  int64_t date;                          // date
-  const char *owner;                     // owner
-  const char *text;                      // text
-} COMMENT;
-
-
 /* global variables */
 time_t g_starttime = 0;                  // start time of the process
 TCMPOOL *g_mpool = NULL;                 // global memory pool
@@ -54,10 +49,20 @@ int g_listnum;                           // number of articles in a list page
 int g_feedlistnum;                       // number of articles in a RSS feed
 int g_filenum;                           // number of files in a file list page
 int g_sidebarnum;                        // number of items in the side bar
+int g_recentnum;                         // number of records of the recent comment table
 const char *g_commentmode;               // comment mode
 const char *g_updatecmd;                 // path of the update command
 int g_sessionlife;                       // lifetime of each session
 const char *g_frontpage;                 // name of the front page
+bool g_rendercache;                      // whether to cache rendered articles
+bool g_cachewrite = false;               // whether the request may write the cache
+BLOCKCACHE *g_blockcache = NULL;         // cache of rendered blocks
+NAMEDIR *g_namedir = NULL;               // directory of article names
+bool g_persistdb = false;                // whether to keep the database open
+TCTDB *g_tdb = NULL;                     // database object kept open
+int g_tdbfd = -1;                        // descriptor to lock the database kept open
+struct stat g_tdbstat;                   // status of the database file kept open
+time_t g_tdbtime = 0;                    // opening time of the database kept open
 
 
 /* function prototypes */
@@ -68,8 +73,15 @@ static void showcache(void);
 static void readpasswd(void);
 static bool writepasswd(void);
 static void dosession(TCMPOOL *mpool);
+static bool opendb(TCMPOOL *mpool, TCTDB **tdbp, int omode);
+static bool closedb(TCTDB *tdb);
+static bool lockdb(int fd, int type);
+static void dropdb(void);
+static TCMAP *getart(TCTDB *tdb, TCBDB *cdb, int64_t id);
 static void setdberrmsg(TCLIST *emsgs, TCTDB *tdb, const char *msg);
-static void setarthtml(TCMPOOL *mpool, TCMAP *cols, int64_t id, int bhl, bool tiny);
+static void setarthtml(TCMPOOL *mpool, TCMAP *cols, int64_t id, int bhl, bool tiny,
+                       bool cache);
+static void warmcache(TCMPOOL *mpool, TCTDB *tdb, int64_t id);
 static TCLIST *searcharts(TCMPOOL *mpool, TCTDB *tdb, const char *cond, const char *expr,
                           const char *order, int max, int skip, bool ls);
 static void getdaterange(const char *expr, int64_t *lowerp, int64_t *upper);
@@ -78,7 +90,6 @@ static bool putfile(TCMPOOL *mpool, const char *path, const char *name,
 static bool outfile(TCMPOOL *mpool, const char *path);
 static TCLIST *searchfiles(TCMPOOL *mpool, const char *expr, const char *order,
                            int max, int skip, bool thum);
-static int comparecomments(const TCLISTDATUM *a, const TCLISTDATUM *b);
 static bool doupdatecmd(TCMPOOL *mpool, const char *mode, const char *baseurl, const char *user,
                         double now, int64_t id, TCMAP *ncols, TCMAP *ocols);
 
@@ -93,6 +104,7 @@ int main(int argc, char **argv){
     g_eventcount++;
     if(realmain(argc, argv) != 0) rv = 1;
   }
+  dropdb();
   tcmpooldel(g_mpool);
   return rv;
 #else
@@ -134,6 +146,10 @@ static int realmain(int argc, char **argv){
     if(pv) *pv = '\0';
     if(*buf != '\0') g_scriptname = buf;
   }
+  if(g_blockcache){
+    g_blockcache->hits = 0;
+    g_blockcache->misses = 0;
+  }
   if(g_tmpl){
     if(g_users){
       int64_t mtime;
@@ -185,6 +201,8 @@ static int realmain(int argc, char **argv){
       g_filenum = tclmax(rp ? tcatoi(rp) : 10, 1);
       rp = tctmplconf(g_tmpl, "sidebarnum");
       g_sidebarnum = tclmax(rp ? tcatoi(rp) : 0, 0);
+      rp = tctmplconf(g_tmpl, "recentnum");
+      g_recentnum = tclmax(rp ? tcatoi(rp) : RECENTNUM, g_sidebarnum);
       g_commentmode = tctmplconf(g_tmpl, "commentmode");
       if(!g_commentmode) g_commentmode = "";
       g_updatecmd = tctmplconf(g_tmpl, "updatecmd");
@@ -193,6 +211,15 @@ static int realmain(int argc, char **argv){
       g_sessionlife = tclmax(rp ? tcatoi(rp) : 0, 0);
       g_frontpage = tctmplconf(g_tmpl, "frontpage");
       if(!g_frontpage) g_frontpage = "";
+      rp = tctmplconf(g_tmpl, "rendercache");
+      g_rendercache = !rp || !strcmp(rp, "on");
+      if(g_rendercache)
+        g_blockcache = tcmpoolpush(g_mpool, blockcachenew(), (void (*)(void *))blockcachedel);
+      g_namedir = tcmpoolpush(g_mpool, namedirnew(), (void (*)(void *))namedirdel);
+#if defined(MYFCGI)
+      rp = tctmplconf(g_tmpl, "persistdb");
+      g_persistdb = !rp || !strcmp(rp, "on");
+#endif
       TCMAP *conf = g_tmpl->conf;
       tcmapiterinit(conf);
       while((rp = tcmapiternext2(conf)) != NULL){
@@ -354,6 +381,7 @@ static void dosession(TCMPOOL *mpool){
   const char *p_format = tcstrskipspc(tcmapget4(params, "format", ""));
   const char *p_act = tcstrskipspc(tcmapget4(params, "act", ""));
   int64_t p_id = tcatoi(tcmapget4(params, "id", ""));
+  int64_t p_rev = tcatoi(tcmapget4(params, "rev", ""));
   const char *p_name = tcstrskipspc(tcmapget4(params, "name", ""));
   const char *p_order = tcstrskipspc(tcmapget4(params, "order", ""));
   const char *p_adjust = tcstrskipspc(tcmapget4(params, "adjust", ""));
@@ -534,7 +562,7 @@ static void dosession(TCMPOOL *mpool){
     }
   }
   // open the database
-  TCTDB *tdb = tcmpoolpush(mpool, tctdbnew(), (void (*)(void *))tctdbdel);
+  TCTDB *tdb;
   int omode = TDBOREADER;
   if(!strcmp(p_act, "update") && auth && post) omode = TDBOWRITER;
   if(!strcmp(p_act, "comment") && cancom && post) omode = TDBOWRITER;
@@ -549,8 +577,19 @@ static void dosession(TCMPOOL *mpool){
       omode = TDBOREADER;
     }
   }
-  if(!tctdbopen(tdb, g_database, omode))
+  // read-only requests never write the cache files and need no locks on them
+  g_cachewrite = omode == TDBOWRITER;
+  if(!opendb(mpool, &tdb, omode)){
     setdberrmsg(emsgs, tdb, "Opening the database was failed.");
+  } else if(g_namedir){
+#if defined(MYFCGI)
+    // the directory is kept by the process and reloaded only when the names are modified
+    if(!namedirload(g_namedir, tdb))
+      setdberrmsg(emsgs, tdb, "Loading the article names was failed.");
+#else
+    namedirsetdb(g_namedir, tdb);
+#endif
+  }
   int64_t mtime = tctdbmtime(tdb);
   if(mtime < 1) mtime = now;
   // prepare the common query
@@ -575,16 +614,13 @@ static void dosession(TCMPOOL *mpool){
           if(checkfrozen(cols) && !admin){
             tclistprintf(emsgs, "Frozen articles are not editable by normal users.");
           } else {
-            TCMAP *ocols = *g_updatecmd != '\0' ? tcmpoolpushmap(mpool, tcmapdup(cols)) : NULL;
-            TCXSTR *wiki = tcmpoolxstrnew(mpool);
-            wikidump(wiki, cols);
-            TCXSTR *line = tcmpoolxstrnew(mpool);
-            tcxstrprintf(line, "%lld|%s|%s\n", (long long)now, owner, text);
-            tcmapputcat(cols, "comments", 8, tcxstrptr(line), tcxstrsize(line));
-            if(dbputart(tdb, p_id, cols)){
-              if(*g_updatecmd != '\0' &&
-                 !doupdatecmd(mpool, "comment", p_scripturl, p_user, now, p_id, cols, ocols))
-                tclistprintf(emsgs, "The update command was failed.");
+            if(dbputcom(tdb, p_id, now, owner, text, g_recentnum)){
+              if(*g_updatecmd != '\0'){
+                TCMAP *ocols = tcmpoolpushmap(mpool, tcmapdup(cols));
+                comadd(cols, now, owner, text);
+                if(!doupdatecmd(mpool, "comment", p_scripturl, p_user, now, p_id, cols, ocols))
+                  tclistprintf(emsgs, "The update command was failed.");
+              }
             } else {
               setdberrmsg(emsgs, tdb, "Storing the article was failed.");
             }
@@ -595,6 +631,10 @@ static void dosession(TCMPOOL *mpool){
       }
     }
   }
+  // open the comment store once for the views which do not write
+  const char *tpath = tctdbpath(tdb);
+  TCBDB *cdb = omode == TDBOREADER && tpath ?
+    tcmpoolpush(mpool, dbopencoms(tpath, false, false), (void (*)(void *))tcbdbdel) : NULL;
   // perform each view
   if(!strcmp(p_act, "login")){
     // login view
@@ -607,7 +647,7 @@ static void dosession(TCMPOOL *mpool){
   } else if(!strcmp(p_act, "edit")){
     // edit view
     if(p_id > 0){
-      TCMAP *cols = tcmpoolpushmap(mpool, dbgetart(tdb, p_id));
+      TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, cdb, p_id));
       if(cols){
         if(checkfrozen(cols) && !admin){
           tclistprintf(emsgs, "Frozen articles are not editable by normal users.");
@@ -636,7 +676,7 @@ static void dosession(TCMPOOL *mpool){
   } else if(!strcmp(p_act, "preview")){
     // preview view
     if(p_id > 0){
-      TCMAP *cols = tcmpoolpushmap(mpool, dbgetart(tdb, p_id));
+      TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, cdb, p_id));
       if(cols){
         if(checkfrozen(cols) && !admin){
           tclistprintf(emsgs, "Frozen articles are not editable by normal users.");
@@ -656,7 +696,7 @@ static void dosession(TCMPOOL *mpool){
               } else if(checkfrozen(cols) && !admin){
                 tclistprintf(emsgs, "The frozen tag is not available by normal users.");
               } else {
-                setarthtml(mpool, cols, p_id, 0, false);
+                setarthtml(mpool, cols, p_id, 0, false, false);
                 tcmapprintf(vars, "titletip", "[preview]");
                 tcmapput2(vars, "view", "preview");
                 tcmapputmap(vars, "art", cols);
@@ -698,7 +738,7 @@ static void dosession(TCMPOOL *mpool){
         tcmapput2(vars, "view", "edit");
         tcmapput2(vars, "wiki", p_wiki);
       } else {
-        setarthtml(mpool, cols, 0, 0, false);
+        setarthtml(mpool, cols, 0, 0, false, false);
         tcmapprintf(vars, "titletip", "[preview]");
         tcmapput2(vars, "view", "preview");
         tcmapputmap(vars, "art", cols);
@@ -711,7 +751,7 @@ static void dosession(TCMPOOL *mpool){
     if(seskey > 0 && p_seskey != seskey){
       tclistprintf(emsgs, "The session key is invalid (%u).", (unsigned int)p_seskey);
     } else if(p_id > 0){
-      TCMAP *cols = tcmpoolpushmap(mpool, dbgetart(tdb, p_id));
+      TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, cdb, p_id));
       if(cols){
         if(checkfrozen(cols) && !admin){
           tclistprintf(emsgs, "Frozen articles are not editable by normal users.");
@@ -732,6 +772,7 @@ static void dosession(TCMPOOL *mpool){
               } else if(checkfrozen(cols) && !admin){
                 tclistprintf(emsgs, "The frozen tag is not available by normal users.");
               } else if(dbputart(tdb, p_id, cols)){
+                warmcache(mpool, tdb, p_id);
                 if(*g_updatecmd != '\0' &&
                    !doupdatecmd(mpool, "update", p_scripturl, p_user, now, p_id, cols, ocols))
                   tclistprintf(emsgs, "The update command was failed.");
@@ -777,6 +818,7 @@ static void dosession(TCMPOOL *mpool){
       } else if(dbputart(tdb, 0, cols)){
         rp = tcmapget2(cols, "id");
         int64_t nid = rp ? tcatoi(rp) : 0;
+        warmcache(mpool, tdb, nid);
         if(*g_updatecmd != '\0' &&
            !doupdatecmd(mpool, "new", p_scripturl, p_user, now, nid, cols, NULL))
           tclistprintf(emsgs, "The update command was failed.");
@@ -980,6 +1022,134 @@ static void dosession(TCMPOOL *mpool){
     } else {
       tclistprintf(emsgs, "The upload directory is missing.");
     }
+  } else if(!strcmp(p_act, "history") && p_id > 0){
+    // history view
+    if(!auth){
+      if(mtime <= p_ifmod){
+        showcache();
+        return;
+      }
+      char numbuf[NUMBUFSIZ];
+      tcdatestrhttp(mtime, 0, numbuf);
+      tcmapput2(vars, "lastmod", numbuf);
+    }
+    TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, cdb, p_id));
+    if(!cols){
+      // removed articles are still shown by their last revision
+      char *wiki = tcmpoolpushptr(mpool, dbgetrev(g_database, p_id, 0));
+      if(wiki){
+        cols = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
+        wikiload(cols, wiki);
+      }
+    }
+    TCLIST *dates = tcmpoolpushlist(mpool, dbgetrevs(g_database, p_id));
+    int rnum = tclistnum(dates);
+    if(cols && rnum > 0){
+      const char *name = tcmapget2(cols, "name");
+      tcmapprintf(vars, "titletip", "[history:%s]", name ? name : "");
+      tcmapput2(vars, "view", "history");
+      tcmapput2(vars, "robots", "noindex,nofollow");
+      tcmapprintf(cols, "id", "%lld", (long long)p_id);
+      tcmapputmap(vars, "target", cols);
+      int max = g_searchnum;
+      int skip = max * (p_page - 1);
+      TCLIST *revs = tcmpoollistnew(mpool);
+      for(int i = rnum - skip - 1; i >= 0 && i >= rnum - skip - max; i--){
+        int64_t date = tcatoi(tclistval2(dates, i));
+        TCMAP *rev = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
+        tcmapprintf(rev, "rev", "%lld", (long long)date);
+        char numbuf[NUMBUFSIZ];
+        tcdatestrwww(date / 1000000, INT_MAX, numbuf);
+        tcmapput2(rev, "date", numbuf);
+        tcmapput2(rev, "datesimple", datestrsimple(numbuf));
+        if(i == rnum - 1) tcmapput2(rev, "latest", "true");
+        tclistpushmap(revs, rev);
+      }
+      if(tclistnum(revs) > 0){
+        if(p_page > 1) tcmapprintf(vars, "prev", "%d", p_page - 1);
+        if(rnum > skip + max) tcmapprintf(vars, "next", "%d", p_page + 1);
+        if(tcmapget2(vars, "prev") || tcmapget2(vars, "next")) tcmapput2(vars, "page", "true");
+        tcmapputlist(vars, "revs", revs);
+      }
+      tcmapprintf(vars, "hitnum", "%d", rnum);
+    } else {
+      tcmapput2(vars, "view", "empty");
+    }
+  } else if(!strcmp(p_act, "revision") && p_id > 0){
+    // revision view
+    if(!auth){
+      if(mtime <= p_ifmod){
+        showcache();
+        return;
+      }
+      char numbuf[NUMBUFSIZ];
+      tcdatestrhttp(mtime, 0, numbuf);
+      tcmapput2(vars, "lastmod", numbuf);
+    }
+    char *wiki = tcmpoolpushptr(mpool, dbgetrev(g_database, p_id, p_rev));
+    if(wiki){
+      TCMAP *cols = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
+      wikiload(cols, wiki);
+      setarthtml(mpool, cols, p_id, 0, false, false);
+      tcmapprintf(cols, "id", "%lld", (long long)p_id);
+      const char *name = tcmapget2(cols, "name");
+      tcmapprintf(vars, "titletip", "[revision:%s]", name ? name : "");
+      tcmapput2(vars, "view", "revision");
+      tcmapput2(vars, "robots", "noindex,nofollow");
+      if(p_rev > 0){
+        char numbuf[NUMBUFSIZ];
+        tcmapprintf(vars, "rev", "%lld", (long long)p_rev);
+        tcdatestrwww(p_rev / 1000000, INT_MAX, numbuf);
+        tcmapput2(vars, "revdate", numbuf);
+        tcmapput2(vars, "revdatesimple", datestrsimple(numbuf));
+      }
+      tcmapput2(vars, "wiki", wiki);
+      tcmapputmap(vars, "art", cols);
+    } else {
+      tcmapput2(vars, "view", "empty");
+    }
+  } else if(!strcmp(p_act, "backlinks") && p_id > 0){
+    // backlinks view
+    if(!auth){
+      if(mtime <= p_ifmod){
+        showcache();
+        return;
+      }
+      char numbuf[NUMBUFSIZ];
+      tcdatestrhttp(mtime, 0, numbuf);
+      tcmapput2(vars, "lastmod", numbuf);
+    }
+    TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, cdb, p_id));
+    if(cols){
+      const char *name = tcmapget2(cols, "name");
+      tcmapprintf(vars, "titletip", "[backlinks:%s]", name ? name : "");
+      tcmapput2(vars, "view", "backlinks");
+      tcmapput2(vars, "robots", "noindex,follow");
+      tcmapprintf(cols, "id", "%lld", (long long)p_id);
+      tcmapputmap(vars, "target", cols);
+      int max = g_searchnum;
+      int skip = max * (p_page - 1);
+      TCLIST *res = tcmpoolpushlist(mpool, dbgetbacklinks(g_database, p_id, name));
+      int rnum = tclistnum(res);
+      TCLIST *arts = tcmpoollistnew(mpool);
+      for(int i = skip; i < rnum && i < skip + max; i++){
+        int64_t id = tcatoi(tclistval2(res, i));
+        TCMAP *acols = tcmpoolpushmap(mpool, id > 0 ? getart(tdb, cdb, id) : NULL);
+        if(acols){
+          setarthtml(mpool, acols, id, 1, true, true);
+          tclistpushmap(arts, acols);
+        }
+      }
+      if(tclistnum(arts) > 0){
+        if(p_page > 1) tcmapprintf(vars, "prev", "%d", p_page - 1);
+        if(rnum > skip + max) tcmapprintf(vars, "next", "%d", p_page + 1);
+        if(tcmapget2(vars, "prev") || tcmapget2(vars, "next")) tcmapput2(vars, "page", "true");
+        tcmapputlist(vars, "arts", arts);
+      }
+      tcmapprintf(vars, "hitnum", "%d", rnum);
+    } else {
+      tcmapput2(vars, "view", "empty");
+    }
   } else if(p_id > 0){
     // single view
     if(!auth && !ridcookie){
@@ -991,9 +1161,9 @@ static void dosession(TCMPOOL *mpool){
       tcdatestrhttp(mtime, 0, numbuf);
       tcmapput2(vars, "lastmod", numbuf);
     }
-    TCMAP *cols = tcmpoolpushmap(mpool, dbgetart(tdb, p_id));
+    TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, cdb, p_id));
     if(cols){
-      setarthtml(mpool, cols, p_id, 0, false);
+      setarthtml(mpool, cols, p_id, 0, false, true);
       if(checkfrozen(cols) && !admin){
         tcmapput2(cols, "frozen", "true");
       } else if(cancom){
@@ -1031,16 +1201,18 @@ static void dosession(TCMPOOL *mpool){
     int max = g_searchnum;
     int skip = max * (p_page - 1);
     const char *order = (*p_order == '\0') ? "_cdate" : p_order;
-    TCLIST *res = searcharts(mpool, tdb, "name", p_name, order, max + 1, skip, false);
+    TCLIST *res = (g_namedir && namedirget(g_namedir, p_name, strlen(p_name)) < 1) ?
+      tcmpoolpushlist(mpool, tclistnew()) :
+      searcharts(mpool, tdb, "name", p_name, order, max + 1, skip, false);
     int rnum = tclistnum(res);
     if(rnum < 1){
       tcmapput2(vars, "view", "empty");
       if(auth) tcmapput2(vars, "missname", p_name);
     } else if(rnum < 2 || p_confirm){
       int64_t id = tcatoi(tclistval2(res, 0));
-      TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? dbgetart(tdb, id) : NULL);
+      TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? getart(tdb, cdb, id) : NULL);
       if(cols){
-        setarthtml(mpool, cols, id, 0, false);
+        setarthtml(mpool, cols, id, 0, false, true);
         if(checkfrozen(cols) && !admin){
           tcmapput2(cols, "frozen", "true");
         } else if(cancom){
@@ -1064,9 +1236,9 @@ static void dosession(TCMPOOL *mpool){
       TCLIST *arts = tcmpoollistnew(mpool);
       for(int i = 0; i < rnum && i < max; i++){
         int64_t id = tcatoi(tclistval2(res, i));
-        TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? dbgetart(tdb, id) : NULL);
+        TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? getart(tdb, cdb, id) : NULL);
         if(cols){
-          setarthtml(mpool, cols, id, 1, true);
+          setarthtml(mpool, cols, id, 1, true, true);
           tclistpushmap(arts, cols);
         }
       }
@@ -1082,6 +1254,40 @@ static void dosession(TCMPOOL *mpool){
       }
     }
     tcmapprintf(vars, "cond", "name:%s", p_name);
+  } else if(!strcmp(p_act, "tags")){
+    // tag cloud view
+    if(!auth){
+      if(mtime <= p_ifmod){
+        showcache();
+        return;
+      }
+      char numbuf[NUMBUFSIZ];
+      tcdatestrhttp(mtime, 0, numbuf);
+      tcmapput2(vars, "lastmod", numbuf);
+    }
+    tcmapprintf(vars, "titletip", "[tags]");
+    tcmapput2(vars, "view", "tags");
+    tcmapput2(vars, "robots", "noindex,follow");
+    TCMAP *counts = tcmpoolpushmap(mpool, dbgetcounts(g_database, "t:"));
+    int max = 1;
+    tcmapiterinit(counts);
+    const char *name;
+    while((name = tcmapiternext2(counts)) != NULL){
+      max = tclmax(max, tcatoi(tcmapiterval2(name)));
+    }
+    TCLIST *tagcloud = tcmpoollistnew(mpool);
+    tcmapiterinit(counts);
+    while((name = tcmapiternext2(counts)) != NULL){
+      int num = tcatoi(tcmapiterval2(name));
+      if(num < 1 || !strcmp(name, "*") || !strcmp(name, "?")) continue;
+      TCMAP *tag = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
+      tcmapput2(tag, "name", name);
+      tcmapprintf(tag, "count", "%d", num);
+      tcmapprintf(tag, "level", "%d", max > 1 ? 1 + (int)(log(num) / log(max) * 4) : 1);
+      tclistpushmap(tagcloud, tag);
+    }
+    if(tclistnum(tagcloud) > 0) tcmapputlist(vars, "tagcloud", tagcloud);
+    tcmapprintf(vars, "hitnum", "%d", tclistnum(tagcloud));
   } else if(!strcmp(p_act, "search")){
     // search view
     if(!auth){
@@ -1103,9 +1309,9 @@ static void dosession(TCMPOOL *mpool){
     TCLIST *arts = tcmpoollistnew(mpool);
     for(int i = 0; i < rnum && i < max; i++){
       int64_t id = tcatoi(tclistval2(res, i));
-      TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? dbgetart(tdb, id) : NULL);
+      TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? getart(tdb, cdb, id) : NULL);
       if(cols){
-        setarthtml(mpool, cols, id, 1, true);
+        setarthtml(mpool, cols, id, 1, true, true);
         tclistpushmap(arts, cols);
       }
     }
@@ -1119,41 +1325,37 @@ static void dosession(TCMPOOL *mpool){
     if(*p_cond != '\0'){
       tcmapprintf(vars, "hitnum", "%d", rnum);
     } else {
-      res = tcmpoollistnew(mpool);
+      // the archive is read from the counter table at once instead of searching each month
       char numbuf[NUMBUFSIZ];
       tcdatestrwww(now, INT_MAX, numbuf);
-      int year = tcatoi(numbuf);
-      int minyear = year;
-      res = searcharts(mpool, tdb, "cdate", "x", "_cdate", 1, 0, true);
-      if(tclistnum(res) > 0){
-        int64_t id = tcatoi(tclistval2(res, 0));
-        TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? dbgetart(tdb, id) : NULL);
-        const char *value = cols ? tcmapget2(cols, "cdate") : NULL;
-        if(value){
-          int64_t cdate = tcstrmktime(value);
-          tcdatestrwww(cdate, INT_MAX, numbuf);
-          minyear = tcatoi(numbuf);
-        }
-      }
+      int maxyear = tcatoi(numbuf);
+      TCMAP *counts = tcmpoolpushmap(mpool, dbgetcounts(g_database, "a:"));
+      TCLIST *months = tcmpoolpushlist(mpool, tcmapkeys(counts));
       TCLIST *arcyears = tcmpoollistnew(mpool);
-      for(int i = 0; i < 100 && year >= minyear; i++){
-        sprintf(numbuf, "%04d", year);
-        res = searcharts(mpool, tdb, "cdate", numbuf, "cdate", 1, 0, true);
-        if(tclistnum(res) > 0){
-          TCMAP *arcmonths = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
-          for(int month = 0; month <= 12; month++){
-            sprintf(numbuf, "%04d-%02d", year, month);
-            res = searcharts(mpool, tdb, "cdate", numbuf, "cdate", 1, 0, true);
-            rnum = tclistnum(res);
-            sprintf(numbuf, "%02d", month);
-            if(rnum > 0) tcmapprintf(arcmonths, numbuf, "%d", rnum);
-          }
-          if(tcmaprnum(arcmonths) > 0){
-            tcmapprintf(arcmonths, "year", "%d", year);
+      TCMAP *arcmonths = NULL;
+      int year = 0;
+      int ysum = 0;
+      for(int i = tclistnum(months) - 1; i >= 0; i--){
+        const char *month = tclistval2(months, i);
+        int myear = tcatoi(month);
+        int num = tcatoi(tcmapget4(counts, month, ""));
+        if(myear > maxyear || myear <= maxyear - 100 || strlen(month) != 7 || num < 1) continue;
+        if(myear != year){
+          if(arcmonths){
+            tcmapprintf(arcmonths, "00", "%d", ysum);
             tclistpushmap(arcyears, arcmonths);
           }
+          arcmonths = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
+          tcmapprintf(arcmonths, "year", "%d", myear);
+          year = myear;
+          ysum = 0;
         }
-        year--;
+        tcmapprintf(arcmonths, month + 5, "%d", num);
+        ysum += num;
+      }
+      if(arcmonths){
+        tcmapprintf(arcmonths, "00", "%d", ysum);
+        tclistpushmap(arcyears, arcmonths);
       }
       if(tclistnum(arcyears) > 0) tcmapputlist(vars, "arcyears", arcyears);
     }
@@ -1184,9 +1386,9 @@ static void dosession(TCMPOOL *mpool){
     tcmapput2(vars, "view", "front");
     tcmapput2(vars, "robots", "index,follow");
     if(id > 0){
-      TCMAP *cols = tcmpoolpushmap(mpool, dbgetart(tdb, id));
+      TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, cdb, id));
       if(cols){
-        setarthtml(mpool, cols, id, 0, false);
+        setarthtml(mpool, cols, id, 0, false, true);
         if(checkfrozen(cols) && !admin) tcmapput2(cols, "frozen", "true");
         tcmapputmap(vars, "art", cols);
       }
@@ -1212,9 +1414,9 @@ static void dosession(TCMPOOL *mpool){
       TCLIST *arts = tcmpoollistnew(mpool);
       for(int i = 0; i < rnum && i < max ; i++){
         int64_t id = tcatoi(tclistval2(res, i));
-        TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? dbgetart(tdb, id) : NULL);
+        TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? getart(tdb, cdb, id) : NULL);
         if(cols){
-          setarthtml(mpool, cols, id, 1, false);
+          setarthtml(mpool, cols, id, 1, false, true);
           tclistpushmap(arts, cols);
         }
       }
@@ -1252,62 +1454,28 @@ static void dosession(TCMPOOL *mpool){
     TCLIST *arts = tcmpoollistnew(mpool);
     for(int i = 0; i < rnum; i++){
       int64_t id = tcatoi(tclistval2(res, i));
-      TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? dbgetart(tdb, id) : NULL);
+      TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? getart(tdb, cdb, id) : NULL);
       if(cols){
-        setarthtml(mpool, cols, id, 1, true);
+        setarthtml(mpool, cols, id, 1, true, true);
         tclistpushmap(arts, cols);
       }
     }
     if(tclistnum(arts) > 0) tcmapputlist(vars, "sidearts", arts);
-    res = searcharts(mpool, tdb, NULL, NULL, "xdate", g_sidebarnum, 0, true);
-    rnum = tclistnum(res);
-    TCLIST *coms = tcmpoollistnew(mpool);
-    for(int i = 0; i < rnum; i++){
-      int64_t id = tcatoi(tclistval2(res, i));
-      TCMAP *cols = tcmpoolpushmap(mpool, id > 0 ? dbgetart(tdb, id) : NULL);
-      if(cols){
-        rp = tcmapget2(cols, "comments");
-        if(rp && *rp != '\0'){
-          TCLIST *lines = tcmpoolpushlist(mpool, tcstrsplit(rp, "\n"));
-          int left = g_sidebarnum;
-          for(int i = tclistnum(lines) - 1; i >= 0 && left > 0; i--, left--){
-            rp = tclistval2(lines, i);
-            char *co = strchr(rp, '|');
-            if(co){
-              *(co++) = '\0';
-              char *ct = strchr(co, '|');
-              if(ct){
-                *(ct++) = '\0';
-                COMMENT com;
-                memset(&com, 0, sizeof(com));
-                com.id = id;
-                com.date = tcatoi(rp);
-                com.owner = co;
-                com.text = ct;
-                tclistpush(coms, &com, sizeof(com));
-              }
-            }
-          }
-        }
-      }
-    }
+    TCLIST *coms = tcmpoolpushlist(mpool, dbgetrecent(g_database, g_sidebarnum));
     int cnum = tclistnum(coms);
     if(cnum > 0){
-      tclistsortex(coms, comparecomments);
       TCLIST *comments = tcmpoolpushlist(mpool, tclistnew2(cnum));
-      for(int i = 0; i < cnum && i < g_sidebarnum; i++){
-        COMMENT *com = (COMMENT *)tclistval2(coms, i);
-        TCMAP *comment = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
-        tcmapprintf(comment, "id", "%lld", (long long)com->id);
+      for(int i = 0; i < cnum; i++){
+        int csiz;
+        const char *cbuf = tclistval(coms, i, &csiz);
+        TCMAP *comment = tcmpoolpushmap(mpool, tcmapload(cbuf, csiz));
         char numbuf[NUMBUFSIZ];
-        tcdatestrwww(com->date, INT_MAX, numbuf);
+        tcdatestrwww(tcatoi(tcmapget4(comment, "date", "0")), INT_MAX, numbuf);
         tcmapput2(comment, "date", numbuf);
         tcmapput2(comment, "datesimple", datestrsimple(numbuf));
-        tcmapput2(comment, "owner", com->owner);
-        tcmapput2(comment, "text", com->text);
-        TCXSTR *xstr = tcmpoolxstrnew(mpool);
-        wikitohtmlinline(xstr, com->text, g_scriptname, g_uploadpub);
-        tcmapput(comment, "texthtml", 8, tcxstrptr(xstr), tcxstrsize(xstr));
+        // the excerpt is plain text which may be cut in the middle of Wiki markup
+        char *html = tcmpoolpushptr(mpool, tcxmlescape(tcmapget4(comment, "text", "")));
+        tcmapput2(comment, "texthtml", html);
         tclistpushmap(comments, comment);
       }
       tcmapputlist(vars, "sidecoms", comments);
@@ -1315,7 +1483,7 @@ static void dosession(TCMPOOL *mpool){
     tcmapput2(vars, "sidebar", "true");
   }
   // close the database
-  if(!tctdbclose(tdb)) setdberrmsg(emsgs, tdb, "Closing the database was failed.");
+  if(!closedb(tdb)) setdberrmsg(emsgs, tdb, "Closing the database was failed.");
   // execute the ending script
   if(g_scrextproc && scrextcheckfunc(g_scrextproc, "_end")){
     char *obuf = tcmpoolpushptr(mpool, scrextcallfunc(g_scrextproc, "_end", ""));
@@ -1399,12 +1567,99 @@ static void dosession(TCMPOOL *mpool){
     printf("\r\n");
   }
   if(g_eventcount > 0) printf("X-Event-Count: %lu\r\n", g_eventcount);
+  if(g_blockcache && g_blockcache->hits + g_blockcache->misses > 0)
+    printf("X-Block-Cache: %lld hits, %lld misses\r\n",
+           (long long)g_blockcache->hits, (long long)g_blockcache->misses);
   printf("\r\n");
   fwrite(tmplstr, 1, strlen(tmplstr), stdout);
   fflush(stdout);
 }
 
 
+/* open the database */
+static bool opendb(TCMPOOL *mpool, TCTDB **tdbp, int omode){
+  assert(mpool && tdbp);
+  if(g_persistdb && omode == TDBOREADER){
+    if(g_tdb){
+      // the shared lock excludes writers of other processes until the request ends
+      struct stat sbuf;
+      if(lockdb(g_tdbfd, F_RDLCK)){
+        if(stat(g_database, &sbuf) == 0 &&
+           sbuf.st_dev == g_tdbstat.st_dev && sbuf.st_ino == g_tdbstat.st_ino &&
+           sbuf.st_size == g_tdbstat.st_size && sbuf.st_mtime == g_tdbstat.st_mtime &&
+           sbuf.st_mtim.tv_nsec == g_tdbstat.st_mtim.tv_nsec && sbuf.st_mtime < g_tdbtime){
+          *tdbp = g_tdb;
+          return true;
+        }
+        lockdb(g_tdbfd, F_UNLCK);
+      }
+      dropdb();
+    }
+    // the object is opened under the lock so that its header is consistent
+    time_t otime = time(NULL);
+    int fd = open(g_database, O_RDONLY);
+    if(fd != -1 && lockdb(fd, F_RDLCK)){
+      TCTDB *tdb = tctdbnew();
+      if(fstat(fd, &g_tdbstat) == 0 && tctdbopen(tdb, g_database, TDBOREADER | TDBONOLCK)){
+        g_tdb = tdb;
+        g_tdbfd = fd;
+        g_tdbtime = otime;
+        *tdbp = tdb;
+        return true;
+      }
+      tctdbdel(tdb);
+    }
+    if(fd != -1) close(fd);
+  }
+  TCTDB *tdb = tcmpoolpush(mpool, tctdbnew(), (void (*)(void *))tctdbdel);
+  *tdbp = tdb;
+  return tctdbopen(tdb, g_database, omode);
+}
+
+
+/* close the database */
+static bool closedb(TCTDB *tdb){
+  assert(tdb);
+  if(tdb == g_tdb) return lockdb(g_tdbfd, F_UNLCK);
+  return tctdbclose(tdb);
+}
+
+
+/* lock or unlock the whole database file in the same way as Tokyo Cabinet does */
+static bool lockdb(int fd, int type){
+  assert(fd >= 0);
+  struct flock lock;
+  memset(&lock, 0, sizeof(lock));
+  lock.l_type = type;
+  lock.l_whence = SEEK_SET;
+  while(fcntl(fd, F_SETLKW, &lock) == -1){
+    if(errno != EINTR) return false;
+  }
+  return true;
+}
+
+
+/* discard the database object kept open */
+static void dropdb(void){
+  if(g_tdb){
+    // closing any descriptor of the file releases the locks of the process
+    tctdbdel(g_tdb);
+    g_tdb = NULL;
+  }
+  if(g_tdbfd != -1){
+    close(g_tdbfd);
+    g_tdbfd = -1;
+  }
+}
+
+
+/* retrieve an article with its comments */
+static TCMAP *getart(TCTDB *tdb, TCBDB *cdb, int64_t id){
+  assert(tdb && id > 0);
+  return cdb ? dbgetart2(tdb, cdb, id) : dbgetart(tdb, id);
+}
+
+
 /* set a database error message */
 static void setdberrmsg(TCLIST *emsgs, TCTDB *tdb, const char *msg){
   tclistprintf(emsgs, "[database error: %s] %s", tctdberrmsg(tctdbecode(tdb)), msg);
@@ -1412,7 +1667,8 @@ static void setdberrmsg(TCLIST *emsgs, TCTDB *tdb, const char *msg){
 
 
 /* set the HTML data of an article */
-static void setarthtml(TCMPOOL *mpool, TCMAP *cols, int64_t id, int bhl, bool tiny){
+static void setarthtml(TCMPOOL *mpool, TCMAP *cols, int64_t id, int bhl, bool tiny,
+                       bool cache){
   if(g_scrextproc && scrextcheckfunc(g_scrextproc, "_procart")){
     TCXSTR *wiki = tcmpoolxstrnew(mpool);
     wikidump(wiki, cols);
@@ -1422,92 +1678,89 @@ static void setarthtml(TCMPOOL *mpool, TCMAP *cols, int64_t id, int bhl, bool ti
       tcmapclear(cols);
       wikiload(cols, obuf);
     }
+    cache = false;
+  }
+  TCMAP *rdata = NULL;
+  TCMAP *ncols = NULL;
+  char *variant = NULL;
+  // the stored summary makes the cache of tiny views useless
+  if(tiny && tcmapget2(cols, "texttiny")) cache = false;
+  if(cache && g_rendercache && id > 0){
+    variant = tcmpoolpushptr(mpool, tcsprintf("%d:%d:%s:%s:%llx", bhl, tiny, g_scriptname,
+                                              g_uploadpub ? g_uploadpub : "",
+                                              g_namedir ?
+                                              (unsigned long long)g_namedir->stamp : 0ULL));
+    rdata = dbgetcache(g_database, id, cols, variant);
+    if(rdata){
+      tcmpoolpushmap(mpool, rdata);
+    } else if(g_cachewrite){
+      ncols = tcmpoolpushmap(mpool, tcmapdup(cols));
+      rdata = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
+    }
   }
   tcmapprintf(cols, "id", "%lld", (long long)id);
   char idbuf[NUMBUFSIZ];
   sprintf(idbuf, "article%lld", (long long)id);
-  char numbuf[NUMBUFSIZ];
-  const char *rp = tcmapget2(cols, "cdate");
-  if(rp){
-    tcdatestrwww(tcstrmktime(rp), INT_MAX, numbuf);
-    tcmapput2(cols, "cdate", numbuf);
-    tcmapput2(cols, "cdatesimple", datestrsimple(numbuf));
-  }
-  rp = tcmapget2(cols, "mdate");
-  if(rp){
-    tcdatestrwww(tcstrmktime(rp), INT_MAX, numbuf);
-    tcmapput2(cols, "mdate", numbuf);
-    tcmapput2(cols, "mdatesimple", datestrsimple(numbuf));
-  }
-  rp = tcmapget2(cols, "xdate");
-  if(rp){
-    tcdatestrwww(tcstrmktime(rp), INT_MAX, numbuf);
-    tcmapput2(cols, "xdate", numbuf);
-    tcmapput2(cols, "xdatesimple", datestrsimple(numbuf));
-  }
-  rp = tcmapget2(cols, "tags");
-  if(rp){
-    TCLIST *tags = tcmpoolpushlist(mpool, tcstrsplit(rp, " ,"));
-    int idx = 0;
-    while(idx < tclistnum(tags)){
-      rp = tclistval2(tags, idx);
-      if(*rp != '\0'){
-        idx++;
-      } else {
-        tcfree(tclistremove2(tags, idx));
-      }
-    }
-    tcmapputlist(cols, "taglist", tags);
-  }
-  rp = tcmapget2(cols, "text");
+  artsetattrs(cols);
+  const char *rp = tcmapget2(cols, "text");
   if(rp && *rp != '\0'){
     if(tiny){
-      TCXSTR *xstr = tcmpoolxstrnew(mpool);
-      wikitotext(xstr, rp);
-      char *str = tcmpoolpushptr(mpool, tcmemdup(tcxstrptr(xstr), tcxstrsize(xstr)));
-      tcstrutfnorm(str, TCUNSPACE);
-      tcstrcututf(str, 256);
-      tcmapput2(cols, "texttiny", str);
+      if(!tcmapget2(cols, "texttiny")){
+        const char *str = (rdata && !ncols) ? tcmapget2(rdata, "texttiny") : NULL;
+        if(!str){
+          str = tcmpoolpushptr(mpool, wikitotiny(rp));
+          if(rdata) tcmapput2(rdata, "texttiny", str);
+        }
+        tcmapput2(cols, "texttiny", str);
+      }
     } else {
-      TCXSTR *xstr = tcmpoolxstrnew(mpool);
-      wikitohtml(xstr, rp, idbuf, g_scriptname, bhl + 1, g_uploadpub);
-      if(tcxstrsize(xstr) > 0) tcmapput(cols, "texthtml", 8, tcxstrptr(xstr), tcxstrsize(xstr));
-    }
-  }
-  rp = tcmapget2(cols, "comments");
-  if(rp && *rp != '\0'){
-    TCLIST *lines = tcmpoolpushlist(mpool, tcstrsplit(rp, "\n"));
-    int cnum = tclistnum(lines);
-    tcmapprintf(cols, "comnum", "%d", cnum);
-    TCLIST *comments = tcmpoolpushlist(mpool, tclistnew2(cnum));
-    int cnt = 0;
-    for(int i = 0; i < cnum; i++){
-      const char *rp = tclistval2(lines, i);
-      char *co = strchr(rp, '|');
-      if(co){
-        *(co++) = '\0';
-        char *ct = strchr(co, '|');
-        if(ct){
-          *(ct++) = '\0';
-          TCMAP *comment = tcmpoolpushmap(mpool, tcmapnew2(TINYBNUM));
-          char numbuf[NUMBUFSIZ];
-          tcdatestrwww(tcatoi(rp), INT_MAX, numbuf);
-          cnt++;
-          tcmapprintf(comment, "cnt", "%d", cnt);
-          tcmapput2(comment, "date", numbuf);
-          tcmapput2(comment, "datesimple", datestrsimple(numbuf));
-          tcmapput2(comment, "owner", co);
-          tcmapput2(comment, "text", ct);
-          TCXSTR *xstr = tcmpoolxstrnew(mpool);
-          wikitohtmlinline(xstr, ct, g_scriptname, g_uploadpub);
-          tcmapput(comment, "texthtml", 8, tcxstrptr(xstr), tcxstrsize(xstr));
-          tclistpushmap(comments, comment);
+      tcmapout2(cols, "texttiny");
+      int hsiz, tsiz;
+      const char *hbuf = (rdata && !ncols) ? tcmapget(rdata, "texthtml", 8, &hsiz) : NULL;
+      const char *tbuf = (rdata && !ncols) ? tcmapget(rdata, "texttoc", 7, &tsiz) : NULL;
+      if(!hbuf || !tbuf){
+        TCXSTR *xstr = tcmpoolxstrnew(mpool);
+        TCXSTR *toc = tcmpoolxstrnew(mpool);
+        if(g_blockcache && bhl == 0 && id > 0){
+          // previews of new articles would share and evict one record of the cache
+          dbgetblocks(g_database, id, g_blockcache);
+          wikitohtml2(xstr, rp, idbuf, g_scriptname, bhl + 1, g_uploadpub, g_blockcache, toc,
+                      g_namedir);
+          if(g_cachewrite) dbputblocks(g_database, id, g_blockcache);
+        } else {
+          wikitohtml2(xstr, rp, idbuf, g_scriptname, bhl + 1, g_uploadpub, NULL, toc, g_namedir);
+        }
+        hbuf = tcxstrptr(xstr);
+        hsiz = tcxstrsize(xstr);
+        tbuf = tcxstrptr(toc);
+        tsiz = tcxstrsize(toc);
+        if(rdata){
+          tcmapput(rdata, "texthtml", 8, hbuf, hsiz);
+          tcmapput(rdata, "texttoc", 7, tbuf, tsiz);
         }
       }
+      if(hsiz > 0) tcmapput(cols, "texthtml", 8, hbuf, hsiz);
+      if(tsiz > 0) artsettoc(cols, tbuf, tsiz);
     }
-    if(tclistnum(comments) > 0) tcmapputlist(cols, "comments", comments);
-    tcmapprintf(cols, "comnum", "%d", tclistnum(comments));
   }
+  artsetcoms(cols, g_scriptname, g_uploadpub, g_namedir, rdata);
+  if(ncols) dbputcache(g_database, id, ncols, variant, rdata);
+}
+
+
+/* render an article stored by the request into the cache */
+static void warmcache(TCMPOOL *mpool, TCTDB *tdb, int64_t id){
+  if(!g_rendercache || id < 1) return;
+  if(g_namedir){
+    // the stamp of the cache depends on the names which may have been modified
+#if defined(MYFCGI)
+    namedirload(g_namedir, tdb);
+#else
+    namedirsetdb(g_namedir, tdb);
+#endif
+  }
+  TCMAP *cols = tcmpoolpushmap(mpool, getart(tdb, NULL, id));
+  if(cols) setarthtml(mpool, cols, id, 0, false, true);
 }
 
 
@@ -1758,18 +2011,6 @@ static TCLIST *searchfiles(TCMPOOL *mpool, const char *expr, const char *order,
 }
 
 
-/* compare two comments by date */
-static int comparecomments(const TCLISTDATUM *a, const TCLISTDATUM *b){
-  COMMENT *coma = (COMMENT *)a->ptr;
-  COMMENT *comb = (COMMENT *)b->ptr;
-  if(coma->date > comb->date) return -1;
-  if(coma->date < comb->date) return 1;
-  if(coma->id > comb->id) return -1;
-  if(coma->id < comb->id) return 1;
-  return strcmp(coma->owner, comb->owner);
-}
-
-
 /* process the update command */
 static bool doupdatecmd(TCMPOOL *mpool, const char *mode, const char *baseurl, const char *user,
                         double now, int64_t id, TCMAP *ncols, TCMAP *ocols){
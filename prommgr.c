@@ -16,8 +16,89 @@
 #include "common.h"
 
 
+typedef TCXSTR *(*WORKPROC)(void *opq, int idx, const char *job);  // type of a job function
+typedef bool (*WORKEMIT)(void *opq, int idx, const char *job, TCXSTR *res);  // type of an emitter
+
+typedef struct {                         // type of structure for a pool of worker threads
+  pthread_mutex_t mutex;                 // mutex for the members
+  pthread_cond_t cond;                   // condition variable notified on each progress
+  TCLIST *jobs;                          // arguments of the jobs
+  TCXSTR **results;                      // results of the jobs
+  bool *done;                            // whether each job has been performed
+  int next;                              // index of the next job
+  int written;                           // number of results which have been emitted
+  int window;                            // maximum number of pending results
+  WORKPROC proc;                         // function performing each job
+  void *opq;                             // opaque pointer for the function
+} WORKPOOL;
+
+typedef struct {                         // type of structure for options of import
+  TCTDB *tdb;                            // database object
+  int tran;                              // number of articles in each transaction
+  int bnum;                              // number of articles in the current transaction
+  int inum;                              // number of imported articles
+  double stime;                          // start time
+  const char *arcpath;                   // path of the archive being read
+} IMPOPTS;
+
+typedef struct {                         // type of structure for options of export
+  TCTDB *tdb;                            // database object
+  TCBDB *cdb;                            // comment store object
+  bool json;                             // whether to output JSON
+  int64_t since;                         // lower limit of the modification date
+  FILE *fp;                              // output stream
+  int num;                               // number of exported articles
+} EXPOPTS;
+
+typedef struct {                         // type of structure for options of conversion
+  TCLIST *sufs;                          // suffixes of the input files
+  int fmt;                               // output format
+  const char *buri;                      // base URI
+  const char *duri;                      // URI of the data directory
+  bool page;                             // whether to output the page header and footer
+  const char *dirpath;                   // path of the output directory
+} CONVOPTS;
+
+typedef struct {                         // type of structure for options of publication
+  TCTDB *tdb;                            // database object
+  TCBDB *cdb;                            // comment store object
+  TCTMPL *tmpl;                          // template object
+  TCMAP *manifest;                       // stamps of the last publication
+  TCMAP *nmanifest;                      // stamps of the current publication
+  NAMEDIR *names;                        // directory of article names
+  int64_t mtime;                         // modification time of the database
+  const char *buri;                      // base URI
+  const char *duri;                      // URI of the data directory
+  const char *dirpath;                   // path of the output directory
+  bool force;                            // whether to publish unchanged articles
+  char *states;                          // state of each article
+} PUBOPTS;
+
+typedef struct {                         // type of structure for a column index
+  const char *name;                      // name of the column
+  int type;                              // type of the index
+  const char *suffix;                    // suffix of the index file
+} IDXSPEC;
+
+enum {                                   // enumeration for states of publication
+  PUBERROR,                              // not readable
+  PUBDONE,                               // published
+  PUBSKIP,                               // skipped because unchanged
+  PUBNOWRITE                             // not writable
+};
+
+
 /* global variables */
 const char *g_progname;                  // program name
+// The suffixes follow the private naming of Tokyo Cabinet, whose table database stores each
+// index in the B+ tree database file "<dbpath>.idx.<column>.<suffix>" (see tctdbsetindex in
+// tctdb.c).  No public API tells the size of an index, so the stats command opens the files by
+// the names and silently omits indexes whose files are not found if the naming changes.
+const IDXSPEC g_idxspecs[] = {           // indexes which the database can have
+  { "name", TDBITLEXICAL, "lex" }, { "cdate", TDBITDECIMAL, "dec" },
+  { "mdate", TDBITDECIMAL, "dec" }, { "xdate", TDBITDECIMAL, "dec" },
+  { "tags", TDBITTOKEN, "tok" }, { "text", TDBITQGRAM, "qgr" }
+};
 
 
 /* function prototypes */
@@ -30,16 +111,55 @@ static int runimport(int argc, char **argv);
 static int runexport(int argc, char **argv);
 static int runupdate(int argc, char **argv);
 static int runremove(int argc, char **argv);
+static int runrefresh(int argc, char **argv);
+static int runrecount(int argc, char **argv);
+static int runbacklinks(int argc, char **argv);
+static int runstats(int argc, char **argv);
+static int runoptimize(int argc, char **argv);
 static int runconvert(int argc, char **argv);
+static int runpublish(int argc, char **argv);
 static int runpasswd(int argc, char **argv);
 static int runversion(int argc, char **argv);
-static int proccreate(const char *dbpath, int scale, bool fts);
-static int procimport(const char *dbpath, TCLIST *files, TCLIST *sufs);
-static int procexport(const char *dbpath, int64_t id, const char *dirpath);
+static int proccreate(const char *dbpath, int scale, bool fts, int opts);
+static int procimport(const char *dbpath, TCLIST *files, TCLIST *sufs, int tran, bool defer,
+                      int thnum);
+static int procexport(const char *dbpath, int64_t id, const char *dirpath, const char *arcpath,
+                      bool json, int64_t since, int thnum);
 static int procupdate(const char *dbpath, int64_t id, const char *wiki);
 static int procremove(const char *dbpath, int64_t id);
+static int procrefresh(const char *dbpath);
+static int procrecount(const char *dbpath, int rnum);
+static int procbacklinks(const char *dbpath, int64_t id, const char *name);
+static int procstats(const char *dbpath);
+static int procoptimize(const char *dbpath, int64_t bnum, int opts);
 static int procconvert(const char *ibuf, int isiz, int fmt,
                        const char *buri, const char *duri, bool page);
+static int procconvertmulti(TCLIST *files, TCLIST *sufs, int fmt, const char *buri,
+                            const char *duri, bool page, const char *dirpath, int thnum);
+static int procpublish(const char *dbpath, const char *dirpath, const char *tmplpath,
+                       const char *buri, const char *duri, int thnum, bool force);
+static void convertwiki(TCXSTR *rbuf, const char *ibuf, int fmt,
+                        const char *buri, const char *duri, bool page);
+static void convertcols(TCXSTR *rbuf, TCMAP *cols, int fmt,
+                        const char *buri, const char *duri, bool page);
+static TCXSTR *workimport(void *opq, int idx, const char *job);
+static bool emitimport(void *opq, int idx, const char *job, TCXSTR *res);
+static void importabort(IMPOPTS *opts);
+static bool importarc(const char *path, int thnum, IMPOPTS *opts);
+static int compareid(const void *a, const void *b);
+static bool exportnewer(TCMAP *cols, int64_t since);
+static void exportjson(TCXSTR *rbuf, TCMAP *cols, const char *id);
+static void jsoncat(TCXSTR *rbuf, const char *ptr, int size);
+static const char *compname(int opts);
+static TCXSTR *workexport(void *opq, int idx, const char *job);
+static bool emitexport(void *opq, int idx, const char *job, TCXSTR *res);
+static TCXSTR *workconvert(void *opq, int idx, const char *job);
+static bool emitconvert(void *opq, int idx, const char *job, TCXSTR *res);
+static TCXSTR *workpublish(void *opq, int idx, const char *job);
+static bool emitpublish(void *opq, int idx, const char *job, TCXSTR *res);
+static void pubsetart(TCMAP *art, PUBOPTS *opts);
+static bool workpoolrun(TCLIST *jobs, int thnum, WORKPROC proc, WORKEMIT emit, void *opq);
+static void *threadwork(void *arg);
 static int procpasswd(const char *name, const char *pass, const char *salt, const char *info);
 static int procversion(void);
 
@@ -59,8 +179,20 @@ int main(int argc, char **argv){
     rv = runupdate(argc, argv);
   } else if(!strcmp(argv[1], "remove")){
     rv = runremove(argc, argv);
+  } else if(!strcmp(argv[1], "refresh")){
+    rv = runrefresh(argc, argv);
+  } else if(!strcmp(argv[1], "recount")){
+    rv = runrecount(argc, argv);
+  } else if(!strcmp(argv[1], "backlinks")){
+    rv = runbacklinks(argc, argv);
+  } else if(!strcmp(argv[1], "stats")){
+    rv = runstats(argc, argv);
+  } else if(!strcmp(argv[1], "optimize")){
+    rv = runoptimize(argc, argv);
   } else if(!strcmp(argv[1], "convert")){
     rv = runconvert(argc, argv);
+  } else if(!strcmp(argv[1], "publish")){
+    rv = runpublish(argc, argv);
   } else if(!strcmp(argv[1], "passwd")){
     rv = runpasswd(argc, argv);
   } else if(!strcmp(argv[1], "version") || !strcmp(argv[1], "--version")){
@@ -77,12 +209,23 @@ static void usage(void){
   fprintf(stderr, "%s: the command line utility of Tokyo Promenade\n", g_progname);
   fprintf(stderr, "\n");
   fprintf(stderr, "usage:\n");
-  fprintf(stderr, "  %s create [-fts] dbpath [scale]\n", g_progname);
-  fprintf(stderr, "  %s import [-suf str] dbpath file ... \n", g_progname);
-  fprintf(stderr, "  %s export [-dir str] dbpath [id]\n", g_progname);
+  fprintf(stderr, "  %s create [-fts] [-deflate|-bzip|-tcbs] dbpath [scale]\n", g_progname);
+  fprintf(stderr, "  %s import [-suf str] [-tran num] [-defer] [-j num] dbpath file ... \n",
+          g_progname);
+  fprintf(stderr, "  %s export [-dir str] [-arc str] [-json] [-since str] [-j num] dbpath [id]\n",
+          g_progname);
   fprintf(stderr, "  %s update id [file]\n", g_progname);
   fprintf(stderr, "  %s remove dbpath id\n", g_progname);
-  fprintf(stderr, "  %s convert [-fw|-ft] [-buri str] [-duri] [-page] [file]\n", g_progname);
+  fprintf(stderr, "  %s refresh dbpath\n", g_progname);
+  fprintf(stderr, "  %s recount [-rnum num] dbpath\n", g_progname);
+  fprintf(stderr, "  %s backlinks [-name str] dbpath [id]\n", g_progname);
+  fprintf(stderr, "  %s stats dbpath\n", g_progname);
+  fprintf(stderr, "  %s optimize [-bnum num] [-deflate|-bzip|-tcbs|-nocomp] dbpath\n",
+          g_progname);
+  fprintf(stderr, "  %s convert [-fw|-ft] [-buri str] [-duri] [-page] [-dir str] [-suf str]"
+          " [-j num] [file ...]\n", g_progname);
+  fprintf(stderr, "  %s publish [-tmpl str] [-buri str] [-duri str] [-j num] [-force]"
+          " dbpath dir\n", g_progname);
   fprintf(stderr, "  %s passwd [-salt str] [-info str] name pass\n", g_progname);
   fprintf(stderr, "  %s version\n", g_progname);
   fprintf(stderr, "\n");
@@ -114,10 +257,17 @@ static int runcreate(int argc, char **argv){
   char *dbpath = NULL;
   char *sstr = NULL;
   bool fts = false;
+  int opts = 0;
   for(int i = 2; i < argc; i++){
     if(!dbpath && argv[i][0] == '-'){
       if(!strcmp(argv[i], "-fts")){
         fts = true;
+      } else if(!strcmp(argv[i], "-deflate")){
+        opts = TDBTDEFLATE;
+      } else if(!strcmp(argv[i], "-bzip")){
+        opts = TDBTBZIP;
+      } else if(!strcmp(argv[i], "-tcbs")){
+        opts = TDBTTCBS;
       } else {
         usage();
       }
@@ -131,7 +281,7 @@ static int runcreate(int argc, char **argv){
   }
   if(!dbpath) usage();
   int scale = sstr ? tcatoix(sstr) : -1;
-  int rv = proccreate(dbpath, scale, fts);
+  int rv = proccreate(dbpath, scale, fts, opts);
   return rv;
 }
 
@@ -141,11 +291,23 @@ static int runimport(int argc, char **argv){
   char *dbpath = NULL;
   TCLIST *files = tcmpoollistnew(tcmpoolglobal());
   TCLIST *sufs = tcmpoollistnew(tcmpoolglobal());
+  int tran = -1;
+  bool defer = false;
+  int thnum = sysconf(_SC_NPROCESSORS_ONLN);
   for(int i = 2; i < argc; i++){
     if(!dbpath && argv[i][0] == '-'){
       if(!strcmp(argv[i], "-suf")){
         if(++i >= argc) usage();
         tclistpush2(sufs, argv[i]);
+      } else if(!strcmp(argv[i], "-tran")){
+        if(++i >= argc) usage();
+        tran = tcatoi(argv[i]);
+      } else if(!strcmp(argv[i], "-defer")){
+        defer = true;
+      } else if(!strcmp(argv[i], "-j")){
+        if(++i >= argc) usage();
+        thnum = tcatoix(argv[i]);
+        if(thnum < 1) usage();
       } else {
         usage();
       }
@@ -156,8 +318,9 @@ static int runimport(int argc, char **argv){
     }
   }
   if(!dbpath || tclistnum(files) < 1) usage();
+  if(thnum < 1) thnum = 1;
   tclistpush2(sufs, ".tpw");
-  int rv = procimport(dbpath, files, sufs);
+  int rv = procimport(dbpath, files, sufs, tran, defer, thnum);
   return rv;
 }
 
@@ -167,11 +330,28 @@ static int runexport(int argc, char **argv){
   char *dbpath = NULL;
   char *idstr = NULL;
   char *dirpath = NULL;
+  char *arcpath = NULL;
+  bool json = false;
+  int64_t since = INT64_MIN;
+  int thnum = sysconf(_SC_NPROCESSORS_ONLN);
   for(int i = 2; i < argc; i++){
     if(!dbpath && argv[i][0] == '-'){
       if(!strcmp(argv[i], "-dir")){
         if(++i >= argc) usage();
         dirpath = argv[i];
+      } else if(!strcmp(argv[i], "-arc")){
+        if(++i >= argc) usage();
+        arcpath = argv[i];
+      } else if(!strcmp(argv[i], "-json")){
+        json = true;
+      } else if(!strcmp(argv[i], "-since")){
+        if(++i >= argc) usage();
+        since = tcstrmktime(argv[i]);
+        if(since == INT64_MIN) usage();
+      } else if(!strcmp(argv[i], "-j")){
+        if(++i >= argc) usage();
+        thnum = tcatoix(argv[i]);
+        if(thnum < 1) usage();
       } else {
         usage();
       }
@@ -184,8 +364,10 @@ static int runexport(int argc, char **argv){
     }
   }
   if(!dbpath) usage();
+  if(thnum < 1) thnum = 1;
+  if(json && !arcpath) arcpath = "-";
   int64_t id = idstr ? tcatoi(idstr) : 0;
-  int rv = procexport(dbpath, id, dirpath);
+  int rv = procexport(dbpath, id, dirpath, arcpath, json, since, thnum);
   return rv;
 }
 
@@ -251,13 +433,139 @@ static int runremove(int argc, char **argv){
 }
 
 
+/* parse arguments of refresh command */
+static int runrefresh(int argc, char **argv){
+  char *dbpath = NULL;
+  for(int i = 2; i < argc; i++){
+    if(!dbpath && argv[i][0] == '-'){
+      usage();
+    } else if(!dbpath){
+      dbpath = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!dbpath) usage();
+  int rv = procrefresh(dbpath);
+  return rv;
+}
+
+
+/* parse arguments of recount command */
+static int runrecount(int argc, char **argv){
+  char *dbpath = NULL;
+  int rnum = RECENTNUM;
+  for(int i = 2; i < argc; i++){
+    if(!dbpath && argv[i][0] == '-'){
+      if(!strcmp(argv[i], "-rnum")){
+        if(++i >= argc) usage();
+        rnum = tcatoi(argv[i]);
+      } else {
+        usage();
+      }
+    } else if(!dbpath){
+      dbpath = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!dbpath || rnum < 1) usage();
+  int rv = procrecount(dbpath, rnum);
+  return rv;
+}
+
+
+/* parse arguments of backlinks command */
+static int runbacklinks(int argc, char **argv){
+  char *dbpath = NULL;
+  char *idstr = NULL;
+  char *name = NULL;
+  for(int i = 2; i < argc; i++){
+    if(!dbpath && argv[i][0] == '-'){
+      if(!strcmp(argv[i], "-name")){
+        if(++i >= argc) usage();
+        name = argv[i];
+      } else {
+        usage();
+      }
+    } else if(!dbpath){
+      dbpath = argv[i];
+    } else if(!idstr){
+      idstr = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!dbpath || (!idstr && !name)) usage();
+  int64_t id = idstr ? tcatoi(idstr) : 0;
+  if(idstr && id < 1) usage();
+  int rv = procbacklinks(dbpath, id, name);
+  return rv;
+}
+
+
+/* parse arguments of stats command */
+static int runstats(int argc, char **argv){
+  char *dbpath = NULL;
+  for(int i = 2; i < argc; i++){
+    if(!dbpath && argv[i][0] == '-'){
+      usage();
+    } else if(!dbpath){
+      dbpath = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!dbpath) usage();
+  int rv = procstats(dbpath);
+  return rv;
+}
+
+
+/* parse arguments of optimize command */
+static int runoptimize(int argc, char **argv){
+  char *dbpath = NULL;
+  int64_t bnum = -1;
+  int opts = -1;
+  for(int i = 2; i < argc; i++){
+    if(!dbpath && argv[i][0] == '-'){
+      if(!strcmp(argv[i], "-bnum")){
+        if(++i >= argc) usage();
+        bnum = tcatoix(argv[i]);
+      } else if(!strcmp(argv[i], "-deflate")){
+        opts = TDBTDEFLATE;
+      } else if(!strcmp(argv[i], "-bzip")){
+        opts = TDBTBZIP;
+      } else if(!strcmp(argv[i], "-tcbs")){
+        opts = TDBTTCBS;
+      } else if(!strcmp(argv[i], "-nocomp")){
+        opts = 0;
+      } else {
+        usage();
+      }
+    } else if(!dbpath){
+      dbpath = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!dbpath) usage();
+  int rv = procoptimize(dbpath, bnum, opts);
+  return rv;
+}
+
+
 /* parse arguments of convert command */
 static int runconvert(int argc, char **argv){
   char *path = NULL;
+  TCLIST *files = tcmpoollistnew(tcmpoolglobal());
+  TCLIST *sufs = tcmpoollistnew(tcmpoolglobal());
   int fmt = FMTHTML;
   char *buri = "promenade.cgi";
   char *duri = NULL;
   bool page = false;
+  char *dirpath = NULL;
+  int thnum = sysconf(_SC_NPROCESSORS_ONLN);
   for(int i = 2; i < argc; i++){
     if(!path && argv[i][0] == '-'){
       if(!strcmp(argv[i], "-fw")){
@@ -272,15 +580,31 @@ static int runconvert(int argc, char **argv){
         duri = argv[i];
       } else if(!strcmp(argv[i], "-page")){
         page = true;
+      } else if(!strcmp(argv[i], "-dir")){
+        if(++i >= argc) usage();
+        dirpath = argv[i];
+      } else if(!strcmp(argv[i], "-suf")){
+        if(++i >= argc) usage();
+        tclistpush2(sufs, argv[i]);
+      } else if(!strcmp(argv[i], "-j")){
+        if(++i >= argc) usage();
+        thnum = tcatoix(argv[i]);
+        if(thnum < 1) usage();
       } else {
         usage();
       }
-    } else if(!path){
-      path = argv[i];
     } else {
-      usage();
+      if(!path) path = argv[i];
+      tclistpush2(files, argv[i]);
     }
   }
+  if(thnum < 1) thnum = 1;
+  bool isdir = false;
+  if(path && path[0] != '@' && !tcstatfile(path, &isdir, NULL, NULL)) isdir = false;
+  if(tclistnum(files) > 1 || dirpath || isdir){
+    tclistpush2(sufs, ".tpw");
+    return procconvertmulti(files, sufs, fmt, buri, duri, page, dirpath, thnum);
+  }
   char *ibuf;
   int isiz;
   if(path && path[0] == '@'){
@@ -300,6 +624,50 @@ static int runconvert(int argc, char **argv){
 }
 
 
+/* parse arguments of publish command */
+static int runpublish(int argc, char **argv){
+  char *dbpath = NULL;
+  char *dirpath = NULL;
+  char *tmplpath = "promenade.tmpl";
+  char *buri = "promenade.cgi";
+  char *duri = NULL;
+  int thnum = sysconf(_SC_NPROCESSORS_ONLN);
+  bool force = false;
+  for(int i = 2; i < argc; i++){
+    if(!dbpath && argv[i][0] == '-'){
+      if(!strcmp(argv[i], "-tmpl")){
+        if(++i >= argc) usage();
+        tmplpath = argv[i];
+      } else if(!strcmp(argv[i], "-buri")){
+        if(++i >= argc) usage();
+        buri = argv[i];
+      } else if(!strcmp(argv[i], "-duri")){
+        if(++i >= argc) usage();
+        duri = argv[i];
+      } else if(!strcmp(argv[i], "-j")){
+        if(++i >= argc) usage();
+        thnum = tcatoix(argv[i]);
+        if(thnum < 1) usage();
+      } else if(!strcmp(argv[i], "-force")){
+        force = true;
+      } else {
+        usage();
+      }
+    } else if(!dbpath){
+      dbpath = argv[i];
+    } else if(!dirpath){
+      dirpath = argv[i];
+    } else {
+      usage();
+    }
+  }
+  if(!dbpath || !dirpath) usage();
+  if(thnum < 1) thnum = 1;
+  int rv = procpublish(dbpath, dirpath, tmplpath, buri, duri, thnum, force);
+  return rv;
+}
+
+
 /* parse arguments of passwd command */
 static int runpasswd(int argc, char **argv){
   char *name = NULL;
@@ -339,10 +707,10 @@ static int runversion(int argc, char **argv){
 
 
 /* perform create command */
-static int proccreate(const char *dbpath, int scale, bool fts){
+static int proccreate(const char *dbpath, int scale, bool fts, int opts){
   TCTDB *tdb = tctdbnew();
   int bnum = (scale > 0) ? scale * 2 : TUNEBNUM;
-  if(!tctdbtune(tdb, bnum, TUNEAPOW, TUNEFPOW, 0)){
+  if(!tctdbtune(tdb, bnum, TUNEAPOW, TUNEFPOW, opts)){
     printdberr(tdb);
     tctdbdel(tdb);
     return 1;
@@ -369,10 +737,18 @@ static int proccreate(const char *dbpath, int scale, bool fts){
     printdberr(tdb);
     err = true;
   }
+  if(!tctdbsetindex(tdb, "tags", TDBITTOKEN | TDBITKEEP) && tctdbecode(tdb) != TCEKEEP){
+    printdberr(tdb);
+    err = true;
+  }
   if(fts && !tctdbsetindex(tdb, "text", TDBITQGRAM | TDBITKEEP) && tctdbecode(tdb) != TCEKEEP){
     printdberr(tdb);
     err = true;
   }
+  if(!dbbuildcounts(tdb)){
+    eprintf("%s%s: building the counter table failed", dbpath, CNTSUFFIX);
+    err = true;
+  }
   if(!tctdbclose(tdb)){
     printdberr(tdb);
     err = true;
@@ -383,16 +759,47 @@ static int proccreate(const char *dbpath, int scale, bool fts){
 
 
 /* perform import command */
-static int procimport(const char *dbpath, TCLIST *files, TCLIST *sufs){
+static int procimport(const char *dbpath, TCLIST *files, TCLIST *sufs, int tran, bool defer,
+                      int thnum){
+  TCLIST *paths = tclistnew();
+  tclistinvert(files);
+  char *fpath;
+  while((fpath = tclistpop2(files)) != NULL){
+    TCLIST *cfiles = tcreaddir(fpath);
+    if(cfiles){
+      tclistsort(cfiles);
+      for(int i = tclistnum(cfiles) - 1; i >= 0; i--){
+        const char *cfile = tclistval2(cfiles, i);
+        bool hit = false;
+        for(int j = 0; j < tclistnum(sufs); j++){
+          if(tcstribwm(cfile, tclistval2(sufs, j))){
+            hit = true;
+            break;
+          }
+        }
+        if(!hit) continue;
+        char *lpath = tcsprintf("%s/%s", fpath, cfile);
+        tclistpush2(files, lpath);
+        tcfree(lpath);
+      }
+      tclistdel(cfiles);
+    } else {
+      tclistpush2(paths, fpath);
+    }
+    tcfree(fpath);
+  }
+  int pnum = tclistnum(paths);
   TCTDB *tdb = tctdbnew();
-  if(!tctdbtune(tdb, TUNEBNUM, TUNEAPOW, TUNEFPOW, 0)){
+  if(!tctdbtune(tdb, tclmax(pnum * 2, TUNEBNUM), TUNEAPOW, TUNEFPOW, 0)){
     printdberr(tdb);
     tctdbdel(tdb);
+    tclistdel(paths);
     return 1;
   }
   if(!tctdbopen(tdb, dbpath, TDBOWRITER | TDBOCREAT)){
     printdberr(tdb);
     tctdbdel(tdb);
+    tclistdel(paths);
     return 1;
   }
   bool err = false;
@@ -412,74 +819,144 @@ static int procimport(const char *dbpath, TCLIST *files, TCLIST *sufs){
     printdberr(tdb);
     err = true;
   }
-  tclistinvert(files);
-  char *fpath;
-  while((fpath = tclistpop2(files)) != NULL){
-    TCLIST *cfiles = tcreaddir(fpath);
-    if(cfiles){
-      tclistsort(cfiles);
-      for(int i = tclistnum(cfiles) - 1; i >= 0; i--){
-        const char *cfile = tclistval2(cfiles, i);
-        bool hit = false;
-        for(int j = 0; j < tclistnum(sufs); j++){
-          if(tcstribwm(cfile, tclistval2(sufs, j))){
-            hit = true;
-            break;
-          }
-        }
-        if(!hit) continue;
-        char *lpath = tcsprintf("%s/%s", fpath, cfile);
-        tclistpush2(files, lpath);
-        tcfree(lpath);
+  if(!tctdbsetindex(tdb, "tags", TDBITTOKEN | TDBITKEEP) && tctdbecode(tdb) != TCEKEEP){
+    printdberr(tdb);
+    err = true;
+  }
+  TCMAP *idxs = tcmapnew2(TINYBNUM);
+  if(defer){
+    // indexes are removed now and built at once after all articles are stored
+    for(int i = 0; i < sizeof(g_idxspecs) / sizeof(*g_idxspecs); i++){
+      const IDXSPEC *spec = g_idxspecs + i;
+      if(tctdbsetindex(tdb, spec->name, TDBITVOID)){
+        tcmapprintf(idxs, spec->name, "%d", spec->type);
+      } else if(tctdbecode(tdb) != TCENOREC){
+        printdberr(tdb);
+        err = true;
       }
-      tclistdel(cfiles);
-    } else {
-      int isiz;
-      char *ibuf = tcreadfile(fpath, IOMAXSIZ, &isiz);
-      if(ibuf){
-        TCMAP *cols = tcmapnew2(TINYBNUM);
-        wikiload(cols, ibuf);
-        const char *name = tcmapget2(cols, "name");
-        if(name && *name != '\0'){
-          int64_t id = tcatoi(tcmapget4(cols, "id", ""));
-          if(dbputart(tdb, id, cols)){
-            id = tcatoi(tcmapget4(cols, "id", ""));
-            printf("%s: imported: id=%lld name=%s\n", fpath, (long long)id, name);
-          } else {
-            printdberr(tdb);
-            err = true;
-          }
-        } else {
-          printf("%s: ignored because there is no name\n", fpath);
-        }
-        tcmapdel(cols);
-        tcfree(ibuf);
+    }
+  }
+  if(tran < 0){
+    // the normal mode opens every side file for each article and is kept for existing articles
+    tran = tctdbrnum(tdb) < 1 ? IMPTRANNUM : 0;
+  }
+  if(tran > 0){
+    char *cpath = tcsprintf("%s%s", dbpath, CACHESUFFIX);
+    if(unlink(cpath) != 0 && tcstatfile(cpath, NULL, NULL, NULL)){
+      eprintf("%s: cannot remove", cpath);
+      err = true;
+    }
+    tcfree(cpath);
+  }
+  IMPOPTS opts;
+  opts.tdb = tdb;
+  opts.tran = tran;
+  opts.bnum = 0;
+  opts.inum = 0;
+  opts.stime = tctime();
+  opts.arcpath = NULL;
+  // consecutive article files are parsed together and each archive is read as a stream
+  TCLIST *jobs = tclistnew();
+  for(int i = 0; i <= pnum; i++){
+    const char *path = (i < pnum) ? tclistval2(paths, i) : NULL;
+    bool arc = false;
+    if(path){
+      int hsiz;
+      char *hbuf = tcreadfile(path, 3, &hsiz);
+      if(hbuf){
+        arc = hsiz == 3 && !memcmp(hbuf, "#@ ", 3);
+        tcfree(hbuf);
+      }
+      if(!arc){
+        tclistpush2(jobs, path);
+        continue;
       }
     }
-    tcfree(fpath);
+    if(tclistnum(jobs) > 0){
+      opts.arcpath = NULL;
+      if(!workpoolrun(jobs, thnum, workimport, emitimport, &opts)) err = true;
+      tclistclear(jobs);
+    }
+    if(arc && !importarc(path, thnum, &opts)) err = true;
+  }
+  tclistdel(jobs);
+  if(opts.bnum > 0){
+    if(!tctdbtrancommit(tdb)){
+      printdberr(tdb);
+      err = true;
+    }
+    double etime = tctime() - opts.stime;
+    printf("committed: %d articles (%.1f articles/sec)\n",
+           opts.inum, etime > 0 ? opts.inum / etime : 0.0);
+  }
+  tcmapiterinit(idxs);
+  const char *name;
+  while((name = tcmapiternext2(idxs)) != NULL){
+    double itime = tctime();
+    if(tctdbsetindex(tdb, name, tcatoi(tcmapiterval2(name))) &&
+       tctdbsetindex(tdb, name, TDBITOPT)){
+      printf("indexed: name=%s (%.3f sec)\n", name, tctime() - itime);
+    } else {
+      printdberr(tdb);
+      err = true;
+    }
+  }
+  tcmapdel(idxs);
+  if(tran > 0){
+    double mtime = tctime();
+    if(dbcleancoms(tdb)){
+      printf("merged: (%.3f sec)\n", tctime() - mtime);
+    } else {
+      eprintf("%s%s: cleaning the comment store failed", dbpath, COMSUFFIX);
+      err = true;
+    }
+    double ltime = tctime();
+    if(dbbuildlinks(tdb)){
+      printf("linked: (%.3f sec)\n", tctime() - ltime);
+    } else {
+      eprintf("%s%s: building the link index failed", dbpath, LINKSUFFIX);
+      err = true;
+    }
+    double ctime = tctime();
+    if(dbbuildcounts(tdb)){
+      printf("counted: (%.3f sec)\n", tctime() - ctime);
+    } else {
+      eprintf("%s%s: building the counter table failed", dbpath, CNTSUFFIX);
+      err = true;
+    }
+  }
+  double rtime = tctime();
+  if(dbbuildrecent(tdb, 0)){
+    if(tran > 0 || defer) printf("listed: (%.3f sec)\n", tctime() - rtime);
+  } else {
+    eprintf("%s%s: building the recent comment table failed", dbpath, RECENTSUFFIX);
+    err = true;
   }
+  if(tran > 0 || defer)
+    printf("finished: %d articles in %.3f sec\n", opts.inum, tctime() - opts.stime);
   if(!tctdbclose(tdb)){
     printdberr(tdb);
     err = true;
   }
   tctdbdel(tdb);
+  tclistdel(paths);
   return err ? 1 : 0;
 }
 
 
 /* perform export command */
-static int procexport(const char *dbpath, int64_t id, const char *dirpath){
+static int procexport(const char *dbpath, int64_t id, const char *dirpath, const char *arcpath,
+                      bool json, int64_t since, int thnum){
   TCTDB *tdb = tctdbnew();
-  if(!tctdbopen(tdb, dbpath, TDBOREADER)){
+  if((arcpath && !tctdbsetmutex(tdb)) || !tctdbopen(tdb, dbpath, TDBOREADER)){
     printdberr(tdb);
     tctdbdel(tdb);
     return 1;
   }
+  TCBDB *cdb = dbopencoms(dbpath, false, arcpath != NULL);
   bool err = false;
   if(id > 0){
-    char pkbuf[NUMBUFSIZ];
-    int pksiz = sprintf(pkbuf, "%lld", (long long)id);
-    TCMAP *cols = tctdbget(tdb, pkbuf, pksiz);
+    TCMAP *cols = dbgetart2(tdb, cdb, id);
     if(cols){
       TCXSTR *rbuf = tcxstrnew3(IOBUFSIZ);
       wikidump(rbuf, cols);
@@ -490,6 +967,57 @@ static int procexport(const char *dbpath, int64_t id, const char *dirpath){
       printdberr(tdb);
       err = true;
     }
+  } else if(arcpath){
+    FILE *fp = strcmp(arcpath, "-") ? fopen(arcpath, "wb") : stdout;
+    if(fp){
+      // only the ID numbers are kept in memory and the articles are read in each partition
+      int64_t anum = 0;
+      int64_t *ids = tcmalloc(sizeof(*ids) * (tctdbrnum(tdb) + 1));
+      if(tctdbiterinit(tdb)){
+        char *pkbuf;
+        int pksiz;
+        while((pkbuf = tctdbiternext(tdb, &pksiz)) != NULL){
+          int64_t pkid = tcatoi(pkbuf);
+          if(pkid > 0 && anum <= tctdbrnum(tdb)) ids[anum++] = pkid;
+          tcfree(pkbuf);
+        }
+      } else {
+        printdberr(tdb);
+        err = true;
+      }
+      qsort(ids, anum, sizeof(*ids), compareid);
+      EXPOPTS opts;
+      opts.tdb = tdb;
+      opts.cdb = cdb;
+      opts.json = json;
+      opts.since = since;
+      opts.fp = fp;
+      opts.num = 0;
+      TCLIST *pkeys = tclistnew2(ARCJOBNUM);
+      for(int64_t i = 0; !err && i < anum; i += ARCJOBNUM){
+        tclistclear(pkeys);
+        for(int64_t j = i; j < anum && j < i + ARCJOBNUM; j++){
+          char pkbuf[NUMBUFSIZ];
+          int pksiz = sprintf(pkbuf, "%lld", (long long)ids[j]);
+          tclistpush(pkeys, pkbuf, pksiz);
+        }
+        if(!workpoolrun(pkeys, thnum, workexport, emitexport, &opts)) err = true;
+      }
+      tclistdel(pkeys);
+      tcfree(ids);
+      if(fp == stdout){
+        if(fflush(fp) != 0) err = true;
+      } else {
+        if(fclose(fp) != 0){
+          eprintf("%s: cannot close", arcpath);
+          err = true;
+        }
+        printf("%s: exported: %d articles\n", arcpath, opts.num);
+      }
+    } else {
+      eprintf("%s: cannot open", arcpath);
+      err = true;
+    }
   } else {
     if(!dirpath) dirpath = ".";
     if(!tctdbiterinit(tdb)){
@@ -500,7 +1028,10 @@ static int procexport(const char *dbpath, int64_t id, const char *dirpath){
     int pksiz;
     while((pkbuf = tctdbiternext(tdb, &pksiz)) != NULL){
       TCMAP *cols = tctdbget(tdb, pkbuf, pksiz);
-      if(cols){
+      if(cols && cdb) dbgetcoms(cdb, tcatoi(pkbuf), cols);
+      if(cols && !exportnewer(cols, since)){
+        tcmapdel(cols);
+      } else if(cols){
         char *name = tcstrdup(tcmapget4(cols, "name", ""));
         tcstrcututf(name, 32);
         char *enc = pathencode(name);
@@ -525,6 +1056,7 @@ static int procexport(const char *dbpath, int64_t id, const char *dirpath){
       tcfree(pkbuf);
     }
   }
+  if(cdb) dbclosecoms(cdb);
   if(!tctdbclose(tdb)){
     printdberr(tdb);
     err = true;
@@ -581,27 +1113,367 @@ static int procremove(const char *dbpath, int64_t id){
 }
 
 
-/* perform convert command */
-static int procconvert(const char *ibuf, int isiz, int fmt,
-                       const char *buri, const char *duri, bool page){
-  TCMAP *cols = tcmapnew2(TINYBNUM);
-  wikiload(cols, ibuf);
-  if(fmt == FMTWIKI){
-    TCXSTR *rbuf = tcxstrnew3(IOBUFSIZ);
-    wikidump(rbuf, cols);
-    fwrite(tcxstrptr(rbuf), 1, tcxstrsize(rbuf), stdout);
-    tcxstrdel(rbuf);
-  } else if(fmt == FMTTEXT){
-    TCXSTR *rbuf = tcxstrnew3(IOBUFSIZ);
+/* perform refresh command */
+static int procrefresh(const char *dbpath){
+  TCTDB *tdb = tctdbnew();
+  if(!tctdbopen(tdb, dbpath, TDBOWRITER)){
+    printdberr(tdb);
+    tctdbdel(tdb);
+    return 1;
+  }
+  bool err = false;
+  char *lpath = tcsprintf("%s%s", dbpath, LINKSUFFIX);
+  if(unlink(lpath) != 0 && tcstatfile(lpath, NULL, NULL, NULL)){
+    eprintf("%s: cannot remove", lpath);
+    err = true;
+  }
+  tcfree(lpath);
+  TCLIST *pkeys = tctdbfwmkeys2(tdb, "", -1);
+  int pknum = tclistnum(pkeys);
+  for(int i = 0; i < pknum; i++){
+    int64_t id = tcatoi(tclistval2(pkeys, i));
+    if(id < 1) continue;
+    TCMAP *cols = dbgetart(tdb, id);
+    if(cols){
+      if(dbputart(tdb, id, cols)){
+        printf("refreshed: id=%lld name=%s\n", (long long)id, tcmapget4(cols, "name", ""));
+      } else {
+        printdberr(tdb);
+        err = true;
+      }
+      tcmapdel(cols);
+    } else {
+      printdberr(tdb);
+      err = true;
+    }
+  }
+  tclistdel(pkeys);
+  if(!tctdbsetindex(tdb, "tags", TDBITTOKEN | TDBITKEEP) && tctdbecode(tdb) != TCEKEEP){
+    printdberr(tdb);
+    err = true;
+  }
+  if(!dbbuildcounts(tdb)){
+    eprintf("%s%s: building the counter table failed", dbpath, CNTSUFFIX);
+    err = true;
+  }
+  if(!dbbuildrecent(tdb, 0)){
+    eprintf("%s%s: building the recent comment table failed", dbpath, RECENTSUFFIX);
+    err = true;
+  }
+  if(!tctdbclose(tdb)){
+    printdberr(tdb);
+    err = true;
+  }
+  tctdbdel(tdb);
+  return err ? 1 : 0;
+}
+
+
+/* perform recount command */
+static int procrecount(const char *dbpath, int rnum){
+  TCTDB *tdb = tctdbnew();
+  if(!tctdbopen(tdb, dbpath, TDBOREADER)){
+    printdberr(tdb);
+    tctdbdel(tdb);
+    return 1;
+  }
+  bool err = false;
+  double stime = tctime();
+  if(dbbuildcounts(tdb)){
+    TCMAP *tags = dbgetcounts(dbpath, "t:");
+    TCMAP *months = dbgetcounts(dbpath, "a:");
+    printf("recounted: %s%s: tags=%lld months=%lld (%.3f sec)\n", dbpath, CNTSUFFIX,
+           (long long)tcmaprnum(tags), (long long)tcmaprnum(months), tctime() - stime);
+    tcmapdel(months);
+    tcmapdel(tags);
+  } else {
+    eprintf("%s%s: building the counter table failed", dbpath, CNTSUFFIX);
+    err = true;
+  }
+  stime = tctime();
+  if(dbbuildrecent(tdb, rnum)){
+    TCLIST *coms = dbgetrecent(dbpath, rnum);
+    printf("recounted: %s%s: comments=%d (%.3f sec)\n", dbpath, RECENTSUFFIX,
+           tclistnum(coms), tctime() - stime);
+    tclistdel(coms);
+  } else {
+    eprintf("%s%s: building the recent comment table failed", dbpath, RECENTSUFFIX);
+    err = true;
+  }
+  if(!tctdbclose(tdb)){
+    printdberr(tdb);
+    err = true;
+  }
+  tctdbdel(tdb);
+  return err ? 1 : 0;
+}
+
+
+/* perform backlinks command */
+static int procbacklinks(const char *dbpath, int64_t id, const char *name){
+  TCTDB *tdb = tctdbnew();
+  if(!tctdbopen(tdb, dbpath, TDBOREADER)){
+    printdberr(tdb);
+    tctdbdel(tdb);
+    return 1;
+  }
+  bool err = false;
+  TCMAP *cols = NULL;
+  if(id > 0){
+    cols = dbgetart(tdb, id);
+    if(cols){
+      if(!name) name = tcmapget2(cols, "name");
+    } else {
+      printdberr(tdb);
+      err = true;
+    }
+  }
+  if(!err){
+    TCLIST *srcs = dbgetbacklinks(dbpath, id, name);
+    for(int i = 0; i < tclistnum(srcs); i++){
+      int64_t src = tcatoi(tclistval2(srcs, i));
+      TCMAP *scols = dbgetart(tdb, src);
+      if(scols){
+        printf("%lld\t%s\n", (long long)src, tcmapget4(scols, "name", ""));
+        tcmapdel(scols);
+      }
+    }
+    tclistdel(srcs);
+  }
+  if(cols) tcmapdel(cols);
+  if(!tctdbclose(tdb)){
+    printdberr(tdb);
+    err = true;
+  }
+  tctdbdel(tdb);
+  return err ? 1 : 0;
+}
+
+
+/* perform stats command */
+static int procstats(const char *dbpath){
+  TCTDB *tdb = tctdbnew();
+  if(!tctdbopen(tdb, dbpath, TDBOREADER)){
+    printdberr(tdb);
+    tctdbdel(tdb);
+    return 1;
+  }
+  bool err = false;
+  int64_t rnum = tctdbrnum(tdb);
+  int64_t bnum = tctdbbnum(tdb);
+  int64_t fsiz = tctdbfsiz(tdb);
+  int64_t rsum = 0;
+  int64_t tsum = 0;
+  int64_t cnum = 0;
+  int64_t canum = 0;
+  int64_t anum = 0;
+  TCBDB *cdb = dbopencoms(dbpath, false, false);
+  if(tctdbiterinit(tdb)){
+    TCMAP *cols;
+    while((cols = tctdbiternext3(tdb)) != NULL){
+      tcmapiterinit(cols);
+      int ksiz;
+      const char *kbuf;
+      while((kbuf = tcmapiternext(cols, &ksiz)) != NULL){
+        int vsiz;
+        tcmapiterval(kbuf, &vsiz);
+        rsum += ksiz + vsiz;
+      }
+      int tsiz;
+      if(tcmapget(cols, "text", 4, &tsiz)) tsum += tsiz;
+      int64_t id = tcatoi(tcmapget4(cols, "", ""));
+      if(cdb && id > 0) dbgetcoms(cdb, id, cols);
+      COMITER iter;
+      comiterinit(&iter, cols);
+      int num = 0;
+      while(comiternext(&iter)){
+        num++;
+      }
+      cnum += num;
+      if(num > 0) canum++;
+      anum++;
+      tcmapdel(cols);
+    }
+  } else {
+    printdberr(tdb);
+    err = true;
+  }
+  printf("path: %s\n", dbpath);
+  printf("record number: %lld\n", (long long)rnum);
+  printf("bucket number: %lld\n", (long long)bnum);
+  printf("bucket load: %.3f\n", bnum > 0 ? (double)rnum / bnum : 0.0);
+  printf("file size: %lld\n", (long long)fsiz);
+  printf("compression: %s\n", compname(tctdbopts(tdb)));
+  printf("record size: %lld (average %.1f)\n",
+         (long long)rsum, anum > 0 ? (double)rsum / anum : 0.0);
+  printf("text size: %lld (average %.1f)\n",
+         (long long)tsum, anum > 0 ? (double)tsum / anum : 0.0);
+  printf("comment number: %lld (in %lld articles)\n", (long long)cnum, (long long)canum);
+  printf("used ratio: %.3f\n", fsiz > 0 ? (double)rsum / fsiz : 0.0);
+  for(int i = 0; i < sizeof(g_idxspecs) / sizeof(*g_idxspecs); i++){
+    const IDXSPEC *spec = g_idxspecs + i;
+    const char *type = "unknown";
+    switch(spec->type){
+      case TDBITLEXICAL: type = "lexical"; break;
+      case TDBITDECIMAL: type = "decimal"; break;
+      case TDBITTOKEN: type = "token"; break;
+      case TDBITQGRAM: type = "qgram"; break;
+    }
+    // the file name depends on the internals of Tokyo Cabinet as noted at g_idxspecs
+    char *ipath = tcsprintf("%s.idx.%s.%s", dbpath, spec->name, spec->suffix);
+    TCBDB *idb = tcbdbnew();
+    if(tcstatfile(ipath, NULL, NULL, NULL) && tcbdbopen(idb, ipath, BDBOREADER | BDBONOLCK)){
+      printf("index: %s (%s): records=%lld size=%lld\n", spec->name, type,
+             (long long)tcbdbrnum(idb), (long long)tcbdbfsiz(idb));
+      tcbdbclose(idb);
+    }
+    tcbdbdel(idb);
+    tcfree(ipath);
+  }
+  if(cdb) dbclosecoms(cdb);
+  const char *sufs[] = { CACHESUFFIX, LINKSUFFIX, COMSUFFIX, REVSUFFIX, CNTSUFFIX, RECENTSUFFIX };
+  for(int i = 0; i < sizeof(sufs) / sizeof(*sufs); i++){
+    char *path = tcsprintf("%s%s", dbpath, sufs[i]);
+    int64_t size;
+    if(tcstatfile(path, NULL, &size, NULL)) printf("%s size: %lld\n", sufs[i] + 1, (long long)size);
+    tcfree(path);
+  }
+  if(!tctdbclose(tdb)){
+    printdberr(tdb);
+    err = true;
+  }
+  tctdbdel(tdb);
+  return err ? 1 : 0;
+}
+
+
+/* perform optimize command */
+static int procoptimize(const char *dbpath, int64_t bnum, int opts){
+  TCTDB *tdb = tctdbnew();
+  if(!tctdbopen(tdb, dbpath, TDBOWRITER)){
+    printdberr(tdb);
+    tctdbdel(tdb);
+    return 1;
+  }
+  bool err = false;
+  int64_t rnum = tctdbrnum(tdb);
+  if(bnum < 1) bnum = tclmax(rnum * 2, TUNEBNUM);
+  // the compression is converted in place while the other options are kept
+  if(opts >= 0) opts |= tctdbopts(tdb) & ~(TDBTDEFLATE | TDBTBZIP | TDBTTCBS | TDBTEXCODEC);
+  int64_t osiz = tctdbfsiz(tdb);
+  double stime = tctime();
+  if(tctdboptimize(tdb, bnum, TUNEAPOW, TUNEFPOW, opts >= 0 ? opts : UINT8_MAX)){
+    printf("optimized: %s: bnum=%lld compression=%s size=%lld->%lld (%.3f sec)\n", dbpath,
+           (long long)bnum, compname(tctdbopts(tdb)),
+           (long long)osiz, (long long)tctdbfsiz(tdb), tctime() - stime);
+  } else {
+    printdberr(tdb);
+    err = true;
+  }
+  for(int i = 0; !err && i < sizeof(g_idxspecs) / sizeof(*g_idxspecs); i++){
+    const char *name = g_idxspecs[i].name;
+    double itime = tctime();
+    if(tctdbsetindex(tdb, name, TDBITOPT)){
+      printf("optimized: index %s (%.3f sec)\n", name, tctime() - itime);
+    } else if(tctdbecode(tdb) != TCENOREC){
+      printdberr(tdb);
+      err = true;
+    }
+  }
+  char *lpath = tcsprintf("%s%s", dbpath, LINKSUFFIX);
+  if(!err && tcstatfile(lpath, NULL, NULL, NULL)){
+    TCBDB *bdb = tcbdbnew();
+    double ltime = tctime();
+    if(tcbdbopen(bdb, lpath, BDBOWRITER) &&
+       tcbdboptimize(bdb, 0, 0, 0, -1, -1, UINT8_MAX) && tcbdbclose(bdb)){
+      printf("optimized: %s (%.3f sec)\n", lpath, tctime() - ltime);
+    } else {
+      eprintf("%s: %s", lpath, tcbdberrmsg(tcbdbecode(bdb)));
+      err = true;
+    }
+    tcbdbdel(bdb);
+  }
+  tcfree(lpath);
+  if(!tctdbclose(tdb)){
+    printdberr(tdb);
+    err = true;
+  }
+  tctdbdel(tdb);
+  return err ? 1 : 0;
+}
+
+
+/* perform convert command */
+static int procconvert(const char *ibuf, int isiz, int fmt,
+                       const char *buri, const char *duri, bool page){
+  TCXSTR *rbuf = tcxstrnew3(IOBUFSIZ);
+  convertwiki(rbuf, ibuf, fmt, buri, duri, page);
+  fwrite(tcxstrptr(rbuf), 1, tcxstrsize(rbuf), stdout);
+  tcxstrdel(rbuf);
+  return 0;
+}
+
+
+/* perform convert command on multiple files */
+static int procconvertmulti(TCLIST *files, TCLIST *sufs, int fmt, const char *buri,
+                            const char *duri, bool page, const char *dirpath, int thnum){
+  TCLIST *paths = tclistnew();
+  for(int i = 0; i < tclistnum(files); i++){
+    const char *fpath = tclistval2(files, i);
+    TCLIST *cfiles = tcreaddir(fpath);
+    if(cfiles){
+      tclistsort(cfiles);
+      for(int j = 0; j < tclistnum(cfiles); j++){
+        const char *cfile = tclistval2(cfiles, j);
+        bool hit = false;
+        for(int k = 0; k < tclistnum(sufs); k++){
+          if(tcstribwm(cfile, tclistval2(sufs, k))){
+            hit = true;
+            break;
+          }
+        }
+        if(hit) tclistprintf(paths, "%s/%s", fpath, cfile);
+      }
+      tclistdel(cfiles);
+    } else {
+      tclistpush2(paths, fpath);
+    }
+  }
+  CONVOPTS opts;
+  opts.sufs = sufs;
+  opts.fmt = fmt;
+  opts.buri = buri;
+  opts.duri = duri;
+  opts.page = page;
+  opts.dirpath = dirpath;
+  bool err = !workpoolrun(paths, thnum, workconvert, emitconvert, &opts);
+  tclistdel(paths);
+  return err ? 1 : 0;
+}
+
+
+/* convert a Wiki string into the specified format */
+static void convertwiki(TCXSTR *rbuf, const char *ibuf, int fmt,
+                        const char *buri, const char *duri, bool page){
+  TCMAP *cols = tcmapnew2(TINYBNUM);
+  wikiload(cols, ibuf);
+  convertcols(rbuf, cols, fmt, buri, duri, page);
+  tcmapdel(cols);
+}
+
+
+/* convert the columns of an article into the specified format */
+static void convertcols(TCXSTR *rbuf, TCMAP *cols, int fmt,
+                        const char *buri, const char *duri, bool page){
+  if(fmt == FMTWIKI){
+    wikidump(rbuf, cols);
+  } else if(fmt == FMTTEXT){
     if(page)
       tcxstrprintf(rbuf, "------------------------ Tokyo Promenade ------------------------\n");
     wikidumptext(rbuf, cols);
     if(page)
       tcxstrprintf(rbuf, "-----------------------------------------------------------------\n");
-    fwrite(tcxstrptr(rbuf), 1, tcxstrsize(rbuf), stdout);
-    tcxstrdel(rbuf);
   } else if(fmt == FMTHTML){
-    TCXSTR *rbuf = tcxstrnew3(IOBUFSIZ);
     if(page){
       const char *name = tcmapget2(cols, "name");
       tcxstrprintf(rbuf, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
@@ -622,11 +1494,604 @@ static int procconvert(const char *ibuf, int isiz, int fmt,
       tcxstrprintf(rbuf, "</body>\n");
       tcxstrprintf(rbuf, "</html>\n");
     }
-    fwrite(tcxstrptr(rbuf), 1, tcxstrsize(rbuf), stdout);
+  }
+}
+
+
+/* check whether an article is modified after a date */
+static bool exportnewer(TCMAP *cols, int64_t since){
+  if(since == INT64_MIN) return true;
+  int64_t mdate = tcatoi(tcmapget4(cols, "mdate", "0"));
+  int64_t xdate = tcatoi(tcmapget4(cols, "xdate", "0"));
+  return mdate > since || xdate > since;
+}
+
+
+/* serialize the columns of an article into a line of JSON */
+static void exportjson(TCXSTR *rbuf, TCMAP *cols, const char *id){
+  tcxstrprintf(rbuf, "{\"id\":%lld", (long long)tcatoi(id));
+  const char *names[] = { "name", "cdate", "mdate", "xdate", "owner", "tags", "text" };
+  for(int i = 0; i < sizeof(names) / sizeof(*names); i++){
+    int vsiz;
+    const char *vbuf = tcmapget(cols, names[i], strlen(names[i]), &vsiz);
+    if(!vbuf) continue;
+    tcxstrprintf(rbuf, ",\"%s\":", names[i]);
+    if(strstr(names[i], "date")){
+      tcxstrprintf(rbuf, "%lld", (long long)tcatoi(vbuf));
+    } else {
+      jsoncat(rbuf, vbuf, vsiz);
+    }
+  }
+  COMITER iter;
+  comiterinit(&iter, cols);
+  bool first = true;
+  while(comiternext(&iter)){
+    tcxstrcat2(rbuf, first ? ",\"comments\":[" : ",");
+    first = false;
+    tcxstrprintf(rbuf, "{\"date\":%lld,\"owner\":", (long long)iter.date);
+    jsoncat(rbuf, iter.owner, iter.osiz);
+    tcxstrcat2(rbuf, ",\"text\":");
+    jsoncat(rbuf, iter.text, iter.tsiz);
+    tcxstrcat(rbuf, "}", 1);
+  }
+  if(!first) tcxstrcat(rbuf, "]", 1);
+  tcxstrcat(rbuf, "}\n", 2);
+}
+
+
+/* concatenate a string literal of JSON */
+static void jsoncat(TCXSTR *rbuf, const char *ptr, int size){
+  tcxstrcat(rbuf, "\"", 1);
+  const char *run = ptr;
+  const char *ep = ptr + size;
+  for(const char *rp = ptr; rp < ep; rp++){
+    int c = *(unsigned char *)rp;
+    if(c >= 0x20 && c != '"' && c != '\\') continue;
+    tcxstrcat(rbuf, run, rp - run);
+    run = rp + 1;
+    switch(c){
+      case '"': tcxstrcat(rbuf, "\\\"", 2); break;
+      case '\\': tcxstrcat(rbuf, "\\\\", 2); break;
+      case '\n': tcxstrcat(rbuf, "\\n", 2); break;
+      case '\r': tcxstrcat(rbuf, "\\r", 2); break;
+      case '\t': tcxstrcat(rbuf, "\\t", 2); break;
+      default: tcxstrprintf(rbuf, "\\u%04x", c); break;
+    }
+  }
+  tcxstrcat(rbuf, run, ep - run);
+  tcxstrcat(rbuf, "\"", 1);
+}
+
+
+/* get the name of the compression of database options */
+static const char *compname(int opts){
+  if(opts & TDBTDEFLATE) return "deflate";
+  if(opts & TDBTBZIP) return "bzip";
+  if(opts & TDBTTCBS) return "tcbs";
+  if(opts & TDBTEXCODEC) return "excodec";
+  return "none";
+}
+
+
+/* serialize an article to export in a worker thread */
+static TCXSTR *workexport(void *opq, int idx, const char *job){
+  EXPOPTS *opts = opq;
+  TCMAP *cols = tctdbget(opts->tdb, job, strlen(job));
+  if(!cols) return NULL;
+  if(opts->cdb) dbgetcoms(opts->cdb, tcatoi(job), cols);
+  TCXSTR *res = tcxstrnew3(IOBUFSIZ);
+  if(exportnewer(cols, opts->since)){
+    if(opts->json){
+      exportjson(res, cols, job);
+    } else {
+      tcmapput2(cols, "id", job);
+      TCXSTR *wiki = tcxstrnew3(IOBUFSIZ);
+      wikidump(wiki, cols);
+      tcxstrprintf(res, "#@ %s %d\n", job, tcxstrsize(wiki));
+      tcxstrcat(res, tcxstrptr(wiki), tcxstrsize(wiki));
+      tcxstrdel(wiki);
+    }
+  }
+  tcmapdel(cols);
+  return res;
+}
+
+
+/* write a serialized article into the archive in the order of the keys */
+static bool emitexport(void *opq, int idx, const char *job, TCXSTR *res){
+  EXPOPTS *opts = opq;
+  if(!res){
+    eprintf("id=%s: cannot read", job);
+    return false;
+  }
+  if(tcxstrsize(res) < 1) return true;
+  if(fwrite(tcxstrptr(res), 1, tcxstrsize(res), opts->fp) != tcxstrsize(res)){
+    eprintf("id=%s: cannot write", job);
+    return false;
+  }
+  opts->num++;
+  return true;
+}
+
+
+/* parse a file to import in a worker thread */
+static TCXSTR *workimport(void *opq, int idx, const char *job){
+  IMPOPTS *opts = opq;
+  char *ibuf;
+  if(opts->arcpath){
+    ibuf = tcstrdup(job);
+  } else {
+    int isiz;
+    ibuf = tcreadfile(job, IOMAXSIZ, &isiz);
+    if(!ibuf) return NULL;
+  }
+  TCMAP *cols = tcmapnew2(TINYBNUM);
+  wikiload(cols, ibuf);
+  tcfree(ibuf);
+  TCXSTR *res;
+  const char *name = tcmapget2(cols, "name");
+  if(name && *name != '\0'){
+    int msiz;
+    void *mbuf = tcmapdump(cols, &msiz);
+    res = tcxstrfrommalloc(mbuf, msiz);
+  } else {
+    res = tcxstrnew();
+  }
+  tcmapdel(cols);
+  return res;
+}
+
+
+/* store a parsed file into the database in the order of the input */
+static bool emitimport(void *opq, int idx, const char *job, TCXSTR *res){
+  IMPOPTS *opts = opq;
+  if(!res) return true;
+  if(opts->arcpath) job = opts->arcpath;
+  if(tcxstrsize(res) < 1){
+    printf("%s: ignored because there is no name\n", job);
+    return true;
+  }
+  TCTDB *tdb = opts->tdb;
+  bool err = false;
+  TCMAP *cols = tcmapload(tcxstrptr(res), tcxstrsize(res));
+  int64_t id = tcatoi(tcmapget4(cols, "id", ""));
+  if(opts->tran > 0 && opts->bnum < 1 && !tctdbtranbegin(tdb)){
+    printdberr(tdb);
+    err = true;
+  } else if(dbputart2(tdb, id, cols, opts->tran > 0)){
+    id = tcatoi(tcmapget4(cols, "id", ""));
+    printf("%s: imported: id=%lld name=%s\n", job, (long long)id, tcmapget4(cols, "name", ""));
+    opts->inum++;
+    if(opts->tran > 0 && ++opts->bnum >= opts->tran){
+      if(tctdbtrancommit(tdb)){
+        opts->bnum = 0;
+        double etime = tctime() - opts->stime;
+        printf("committed: %d articles (%.1f articles/sec)\n",
+               opts->inum, etime > 0 ? opts->inum / etime : 0.0);
+      } else {
+        printdberr(tdb);
+        err = true;
+        importabort(opts);
+      }
+    }
+  } else {
+    printdberr(tdb);
+    err = true;
+    // the batch is discarded and the following articles are stored in a new one
+    if(opts->tran > 0) importabort(opts);
+  }
+  tcmapdel(cols);
+  return !err;
+}
+
+
+/* abort the current transaction of import */
+static void importabort(IMPOPTS *opts){
+  // the error of a transaction which has been closed by a failed commit is ignored
+  tctdbtranabort(opts->tdb);
+  printf("aborted: %d articles\n", opts->bnum);
+  opts->inum -= opts->bnum;
+  opts->bnum = 0;
+}
+
+
+/* import the articles in an archive file written by the export command */
+static bool importarc(const char *path, int thnum, IMPOPTS *opts){
+  FILE *fp = fopen(path, "rb");
+  if(!fp){
+    eprintf("%s: cannot open", path);
+    return false;
+  }
+  bool err = false;
+  opts->arcpath = path;
+  TCLIST *jobs = tclistnew2(ARCJOBNUM);
+  int64_t jsiz = 0;
+  char line[LINEBUFSIZ];
+  while(true){
+    bool end = !fgets(line, sizeof(line), fp);
+    if(!end){
+      int64_t size = -1;
+      char *pv = strncmp(line, "#@ ", 3) ? NULL : strchr(line + 3, ' ');
+      if(pv) size = tcatoi(pv + 1);
+      if(size < 0 || size > IOMAXSIZ){
+        eprintf("%s: invalid record", path);
+        err = true;
+        end = true;
+      } else {
+        char *buf = tcmalloc(size + 1);
+        if(fread(buf, 1, size, fp) == size){
+          buf[size] = '\0';
+          tclistpushmalloc(jobs, buf, size);
+          jsiz += size;
+        } else {
+          eprintf("%s: truncated record", path);
+          tcfree(buf);
+          err = true;
+          end = true;
+        }
+      }
+    }
+    if(tclistnum(jobs) > 0 && (end || tclistnum(jobs) >= ARCJOBNUM || jsiz >= IOMAXSIZ)){
+      if(!workpoolrun(jobs, thnum, workimport, emitimport, opts)) err = true;
+      tclistclear(jobs);
+      jsiz = 0;
+    }
+    if(end) break;
+  }
+  tclistdel(jobs);
+  if(ferror(fp)){
+    eprintf("%s: cannot read", path);
+    err = true;
+  }
+  fclose(fp);
+  opts->arcpath = NULL;
+  return !err;
+}
+
+
+/* compare two ID numbers for sorting */
+static int compareid(const void *a, const void *b){
+  int64_t ia = *(int64_t *)a;
+  int64_t ib = *(int64_t *)b;
+  return (ia > ib) - (ia < ib);
+}
+
+
+/* convert a file in a worker thread */
+static TCXSTR *workconvert(void *opq, int idx, const char *job){
+  CONVOPTS *opts = opq;
+  int isiz;
+  char *ibuf = tcreadfile(job, IOMAXSIZ, &isiz);
+  if(!ibuf) return NULL;
+  TCXSTR *rbuf = tcxstrnew3(isiz * 2 + IOBUFSIZ);
+  convertwiki(rbuf, ibuf, opts->fmt, opts->buri, opts->duri, opts->page);
+  tcfree(ibuf);
+  return rbuf;
+}
+
+
+/* output the result of conversion of a file */
+static bool emitconvert(void *opq, int idx, const char *job, TCXSTR *res){
+  CONVOPTS *opts = opq;
+  if(!res){
+    eprintf("%s: cannot open", job);
+    return false;
+  }
+  if(!opts->dirpath){
+    fwrite(tcxstrptr(res), 1, tcxstrsize(res), stdout);
+    return true;
+  }
+  const char *name = strrchr(job, '/');
+  name = name ? name + 1 : job;
+  int nsiz = strlen(name);
+  for(int i = 0; i < tclistnum(opts->sufs); i++){
+    const char *suf = tclistval2(opts->sufs, i);
+    if(tcstribwm(name, suf)){
+      nsiz -= strlen(suf);
+      break;
+    }
+  }
+  TCXSTR *opath = tcxstrnew();
+  tcxstrprintf(opath, "%s/", opts->dirpath);
+  tcxstrcat(opath, name, nsiz);
+  tcxstrcat2(opath, opts->fmt == FMTWIKI ? ".tpw" : opts->fmt == FMTTEXT ? ".txt" : ".html");
+  const char *opstr = tcxstrptr(opath);
+  bool err = false;
+  if(tcwritefile(opstr, tcxstrptr(res), tcxstrsize(res))){
+    printf("%s: converted: %s\n", job, opstr);
+  } else {
+    eprintf("%s: cannot write", opstr);
+    err = true;
+  }
+  tcxstrdel(opath);
+  return !err;
+}
+
+
+/* publish an article in a worker thread */
+static TCXSTR *workpublish(void *opq, int idx, const char *job){
+  PUBOPTS *opts = opq;
+  TCMAP *cols = tctdbget(opts->tdb, job, strlen(job));
+  if(!cols){
+    opts->states[idx] = PUBERROR;
+    return NULL;
+  }
+  if(opts->cdb) dbgetcoms(opts->cdb, tcatoi(job), cols);
+  TCXSTR *stamp = tcxstrnew();
+  tcxstrprintf(stamp, "%s:%s:%llx", tcmapget4(cols, "mdate", ""), tcmapget4(cols, "xdate", ""),
+               (unsigned long long)opts->names->stamp);
+  char *path = tcsprintf("%s/%s.html", opts->dirpath, job);
+  const char *ostamp = tcmapget2(opts->manifest, job);
+  if(!opts->force && ostamp && !strcmp(ostamp, tcxstrptr(stamp)) &&
+     tcstatfile(path, NULL, NULL, NULL)){
+    opts->states[idx] = PUBSKIP;
+  } else {
+    tcmapput2(cols, "id", job);
+    TCXSTR *rbuf = tcxstrnew3(IOBUFSIZ);
+    // the variables are the same as those of the single view of the CGI script
+    pubsetart(cols, opts);
+    TCMAP *vars = tcmapnew2(TINYBNUM);
+    tcmapputmap(vars, "art", cols);
+    tcmapput2(vars, "view", "single");
+    tcmapput2(vars, "robots", "index,follow");
+    const char *name = tcmapget2(cols, "name");
+    if(name) tcmapput2(vars, "titletip", name);
+    tcmapprintf(vars, "cond", "id:%s", job);
+    tcmapput2(vars, "scriptname", opts->buri);
+    char *prefix = tcregexreplace(opts->buri, "\\.[a-zA-Z0-9]*$", "");
+    tcmapput2(vars, "scriptprefix", prefix);
+    tcfree(prefix);
+    if(opts->duri) tcmapput2(vars, "uploadpub", opts->duri);
+    tcmapput2(vars, "buri", opts->buri);
+    if(opts->duri) tcmapput2(vars, "duri", opts->duri);
+    tcmapput2(vars, "tpversion", TPVERSION);
+    char numbuf[NUMBUFSIZ];
+    tcdatestrwww(tctime(), INT_MAX, numbuf);
+    tcmapput2(vars, "now", numbuf);
+    tcdatestrwww(opts->mtime, INT_MAX, numbuf);
+    tcmapput2(vars, "mtime", numbuf);
+    tcmapput2(vars, "mtimesimple", datestrsimple(numbuf));
+    tcmapput2(vars, "format", "html");
+    tcmapput2(vars, "mimetype", "text/html; charset=UTF-8");
+    char *str = tctmpldump(opts->tmpl, vars);
+    const char *rp = str;
+    while(*rp > '\0' && *rp <= ' '){
+      rp++;
+    }
+    tcxstrcat2(rbuf, rp);
+    tcfree(str);
+    tcmapdel(vars);
+    opts->states[idx] = tcwritefile(path, tcxstrptr(rbuf), tcxstrsize(rbuf)) ?
+      PUBDONE : PUBNOWRITE;
     tcxstrdel(rbuf);
   }
+  tcfree(path);
   tcmapdel(cols);
-  return 0;
+  return stamp;
+}
+
+
+/* record the result of publication of an article */
+static bool emitpublish(void *opq, int idx, const char *job, TCXSTR *res){
+  PUBOPTS *opts = opq;
+  switch(opts->states[idx]){
+    case PUBDONE:
+      printf("%s/%s.html: published: id=%s\n", opts->dirpath, job, job);
+      break;
+    case PUBSKIP:
+      break;
+    case PUBNOWRITE:
+      eprintf("%s/%s.html: cannot write", opts->dirpath, job);
+      return false;
+    default:
+      eprintf("id=%s: cannot read", job);
+      return false;
+  }
+  tcmapput(opts->nmanifest, job, strlen(job), tcxstrptr(res), tcxstrsize(res));
+  return true;
+}
+
+
+/* set the template variables of an article to be published */
+static void pubsetart(TCMAP *art, PUBOPTS *opts){
+  artsetattrs(art);
+  const char *rp = tcmapget2(art, "text");
+  if(rp && *rp != '\0'){
+    char idbuf[NUMBUFSIZ];
+    sprintf(idbuf, "article%s", tcmapget4(art, "id", ""));
+    TCXSTR *html = tcxstrnew3(IOBUFSIZ);
+    TCXSTR *toc = tcxstrnew();
+    wikitohtml2(html, rp, idbuf, opts->buri, 1, opts->duri, NULL, toc, opts->names);
+    if(tcxstrsize(html) > 0) tcmapput(art, "texthtml", 8, tcxstrptr(html), tcxstrsize(html));
+    if(tcxstrsize(toc) > 0) artsettoc(art, tcxstrptr(toc), tcxstrsize(toc));
+    tcxstrdel(toc);
+    tcxstrdel(html);
+  }
+  artsetcoms(art, opts->buri, opts->duri, opts->names, NULL);
+}
+
+
+/* perform jobs in worker threads and emit the results in order */
+static bool workpoolrun(TCLIST *jobs, int thnum, WORKPROC proc, WORKEMIT emit, void *opq){
+  int jnum = tclistnum(jobs);
+  if(thnum > jnum) thnum = tclmax(jnum, 1);
+  WORKPOOL pool;
+  pthread_mutex_init(&pool.mutex, NULL);
+  pthread_cond_init(&pool.cond, NULL);
+  pool.jobs = jobs;
+  pool.results = tccalloc(jnum + 1, sizeof(*pool.results));
+  pool.done = tccalloc(jnum + 1, sizeof(*pool.done));
+  pool.next = 0;
+  pool.written = 0;
+  pool.window = thnum * 4;
+  pool.proc = proc;
+  pool.opq = opq;
+  pthread_t *ths = tcmalloc(sizeof(*ths) * thnum);
+  int tnum = 0;
+  bool err = false;
+  for(int i = 0; i < thnum; i++){
+    if(pthread_create(ths + tnum, NULL, threadwork, &pool) != 0){
+      eprintf("pthread_create failed");
+      err = true;
+      break;
+    }
+    tnum++;
+  }
+  for(int i = 0; i < jnum && tnum > 0; i++){
+    pthread_mutex_lock(&pool.mutex);
+    while(!pool.done[i]){
+      pthread_cond_wait(&pool.cond, &pool.mutex);
+    }
+    TCXSTR *res = pool.results[i];
+    pool.results[i] = NULL;
+    pthread_mutex_unlock(&pool.mutex);
+    if(!emit(opq, i, tclistval2(jobs, i), res)) err = true;
+    if(res) tcxstrdel(res);
+    pthread_mutex_lock(&pool.mutex);
+    pool.written = i + 1;
+    pthread_cond_broadcast(&pool.cond);
+    pthread_mutex_unlock(&pool.mutex);
+  }
+  for(int i = 0; i < tnum; i++){
+    pthread_join(ths[i], NULL);
+  }
+  tcfree(ths);
+  tcfree(pool.done);
+  tcfree(pool.results);
+  pthread_cond_destroy(&pool.cond);
+  pthread_mutex_destroy(&pool.mutex);
+  return !err;
+}
+
+
+/* perform jobs in a worker thread */
+static void *threadwork(void *arg){
+  WORKPOOL *pool = arg;
+  int jnum = tclistnum(pool->jobs);
+  while(true){
+    pthread_mutex_lock(&pool->mutex);
+    while(pool->next < jnum && pool->next >= pool->written + pool->window){
+      pthread_cond_wait(&pool->cond, &pool->mutex);
+    }
+    int idx = (pool->next < jnum) ? pool->next++ : -1;
+    pthread_mutex_unlock(&pool->mutex);
+    if(idx < 0) break;
+    TCXSTR *res = pool->proc(pool->opq, idx, tclistval2(pool->jobs, idx));
+    pthread_mutex_lock(&pool->mutex);
+    pool->results[idx] = res;
+    pool->done[idx] = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+  return NULL;
+}
+
+
+/* perform publish command */
+static int procpublish(const char *dbpath, const char *dirpath, const char *tmplpath,
+                       const char *buri, const char *duri, int thnum, bool force){
+  TCTMPL *tmpl = tctmplnew();
+  if(!tctmplload2(tmpl, tmplpath)){
+    eprintf("%s: cannot open", tmplpath);
+    tctmpldel(tmpl);
+    return 1;
+  }
+  TCTDB *tdb = tctdbnew();
+  if(!tctdbsetmutex(tdb) || !tctdbopen(tdb, dbpath, TDBOREADER)){
+    printdberr(tdb);
+    tctdbdel(tdb);
+    tctmpldel(tmpl);
+    return 1;
+  }
+  TCBDB *cdb = dbopencoms(dbpath, false, true);
+  NAMEDIR *names = namedirnew();
+  names->pub = true;
+  // looking up names in the database memoizes results and is not thread-safe
+  namedirload(names, tdb);
+  if(names->tdb) thnum = 1;
+  int64_t mtime;
+  if(!tcstatfile(dbpath, NULL, NULL, &mtime)) mtime = 0;
+  bool err = false;
+  char *mpath = tcsprintf("%s/%s", dirpath, PUBMANIFEST);
+  TCMAP *manifest = tcmapnew2(TINYBNUM);
+  int msiz;
+  char *mbuf = tcreadfile(mpath, -1, &msiz);
+  if(mbuf){
+    TCLIST *lines = tcstrsplit(mbuf, "\n");
+    for(int i = 0; i < tclistnum(lines); i++){
+      char *line = (char *)tclistval2(lines, i);
+      char *pv = strchr(line, '\t');
+      if(!pv) continue;
+      *(pv++) = '\0';
+      tcmapput2(manifest, line, pv);
+    }
+    tclistdel(lines);
+    tcfree(mbuf);
+  }
+  TCLIST *ids = tclistnew2(tctdbrnum(tdb) + 1);
+  if(tctdbiterinit(tdb)){
+    char *pkbuf;
+    int pksiz;
+    while((pkbuf = tctdbiternext(tdb, &pksiz)) != NULL){
+      tclistpushmalloc(ids, pkbuf, pksiz);
+    }
+  } else {
+    printdberr(tdb);
+    err = true;
+  }
+  PUBOPTS opts;
+  opts.tdb = tdb;
+  opts.cdb = cdb;
+  opts.tmpl = tmpl;
+  opts.manifest = manifest;
+  opts.nmanifest = tcmapnew2(tclistnum(ids) + 1);
+  opts.names = names;
+  opts.mtime = mtime;
+  opts.buri = buri;
+  opts.duri = duri;
+  opts.dirpath = dirpath;
+  opts.force = force;
+  opts.states = tccalloc(tclistnum(ids) + 1, 1);
+  if(!workpoolrun(ids, thnum, workpublish, emitpublish, &opts)) err = true;
+  tcmapiterinit(manifest);
+  const char *id;
+  while((id = tcmapiternext2(manifest)) != NULL){
+    if(tcmapget2(opts.nmanifest, id) || tctdbvsiz(tdb, id, strlen(id)) >= 0) continue;
+    char *path = tcsprintf("%s/%s.html", dirpath, id);
+    if(unlink(path) == 0 || !tcstatfile(path, NULL, NULL, NULL)){
+      printf("%s: removed: id=%s\n", path, id);
+    } else {
+      eprintf("%s: cannot remove", path);
+      err = true;
+    }
+    tcfree(path);
+  }
+  TCXSTR *xstr = tcxstrnew();
+  tcmapiterinit(opts.nmanifest);
+  while((id = tcmapiternext2(opts.nmanifest)) != NULL){
+    tcxstrprintf(xstr, "%s\t%s\n", id, tcmapiterval2(id));
+  }
+  char *tpath = tcsprintf("%s.tmp", mpath);
+  if(!tcwritefile(tpath, tcxstrptr(xstr), tcxstrsize(xstr)) || rename(tpath, mpath) != 0){
+    eprintf("%s: cannot write", mpath);
+    err = true;
+  }
+  tcfree(tpath);
+  tcxstrdel(xstr);
+  tcfree(opts.states);
+  tcmapdel(opts.nmanifest);
+  tclistdel(ids);
+  tcmapdel(manifest);
+  tcfree(mpath);
+  if(cdb) dbclosecoms(cdb);
+  if(!tctdbclose(tdb)){
+    printdberr(tdb);
+    err = true;
+  }
+  tctdbdel(tdb);
+  namedirdel(names);
+  tctmpldel(tmpl);
+  return err ? 1 : 0;
 }
 
 